@@ -3,19 +3,45 @@
 //       Subtracts backgrounds, performs unfolding, applies efficiency x acceptance correction, and 
 //       divides by flux and number of nucleons.  Writes a .root file with the cross section histogram.
 //
-//Usage: ExtractCrossSection <unfolding iterations> <data.root> <mc.root>
+//Usage: ExtractCrossSection <unfolding iterations> <data.root> <mc.root> [-j <nWorkers>] [-u <nUnfoldWorkers>] [-s <sideband>] [--no-plots] [<prefix>=<edge>,<edge>,...]...
+//
+//       Each prefix is extracted independently on one of nWorkers threads.  nWorkers
+//       defaults to the number of cores on this machine.  A failure for one prefix
+//       doesn't stop the others.
+//
+//       Each prefix unfolds its error band universes on nUnfoldWorkers threads.
+//       nUnfoldWorkers defaults to whatever cores are left over from nWorkers.  With
+//       -u 1, every universe is unfolded by a single MnvUnfold call instead.
+//
+//       With -s, every background is scaled universe by universe so that their sum matches
+//       the data minus signal in the sideband runEventLoop filled when MNV101_SIDEBANDS named it.
+//
+//       Plots of each step are drawn on a separate thread while extraction continues.
+//       --no-plots skips them entirely for batch jobs.
+//
+//       Each optional <prefix>=... argument extracts that prefix from the "fine" directory
+//       runEventLoop writes when MNV101_FINE_BINS is set, rebinned to the bin edges given.
+//
+//       Covariance matrices for each error band, their total, and the correlation matrix
+//       are written next to the cross section.  Set MNV101_CHECK_COVARIANCE to compare
+//       them to MnvH1D's own covariance matrices.  Set MNV101_CHECK_UNFOLDING_COV to
+//       compare the statistical covariance from unfolding to a second unfolding pass.
 //
 //Author: Andrew Olivier aolivier@ur.rochester.edu
 
 //util includes
 #include "util/GetIngredient.h"
+#include "util/Rebin.h"
+#include "util/Unfold.h"
+#include "util/UniverseMatrix.h"
+#include "util/CrossSectionSteps.h"
+#include "util/Covariance.h"
+#include "util/PlotQueue.h"
+#include "util/Manifest.h"
 
-//UnfoldUtils includes
+//PlotUtils includes
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Woverloaded-virtual"
-#include "MinervaUnfold/MnvUnfold.h"
-
-//PlotUtils includes
 #include "PlotUtils/MnvH1D.h"
 #include "PlotUtils/MnvH2D.h"
 #include "PlotUtils/MnvPlotter.h"
@@ -24,9 +50,9 @@
 //ROOT includes
 #include "TH1D.h"
 #include "TFile.h"
-#include "TKey.h"
 #include "TParameter.h"
 #include "TCanvas.h"
+#include "TROOT.h"
 
 //Cintex is only needed for older ROOT versions like the GPVMs.
 ////Let CMake decide whether it's needed.
@@ -38,98 +64,222 @@
 #include <iostream>
 #include <exception>
 #include <algorithm>
-#include <numeric>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+//Plot a step in cross section extraction on plots' graphics thread.  Takes
+//ownership of hist because drawing happens later.  Does nothing if plots is nullptr.
+void Plot(util::PlotQueue* plots, std::unique_ptr<PlotUtils::MnvH1D> hist, const std::string& stepName, const std::string& prefix)
+{
+  if(!plots) return;
+
+  std::shared_ptr<PlotUtils::MnvH1D> toDraw(std::move(hist));
+  plots->Push([toDraw, stepName, prefix]()
+              {
+                TCanvas can(stepName.c_str());
+                toDraw->GetCVHistoWithError().Clone()->Draw();
+                can.Print((prefix + "_" + stepName + ".png").c_str());
+
+                //Uncertainty summary
+                PlotUtils::MnvPlotter plotter;
+                plotter.ApplyStyle(PlotUtils::kCCQENuStyle);
+                plotter.axis_maximum = 0.4;
+
+                plotter.DrawErrorSummary(toDraw.get());
+                can.Print((prefix + "_" + stepName + "_uncertaintySummary.png").c_str());
+
+                plotter.DrawErrorSummary(toDraw.get(), "TR", true, true, 1e-5, false, "Other");
+                can.Print((prefix + "_" + stepName + "_otherUncertainties.png").c_str());
+              });
+}
 
-//Convince the STL to talk to TIter so I can use std::find_if()
-namespace std
+//Plot a copy of hist so that the caller can keep using it
+void Plot(util::PlotQueue* plots, const PlotUtils::MnvH1D& hist, const std::string& stepName, const std::string& prefix)
 {
-  template <>
-  struct iterator_traits<TIter>
-  {
-    using value_type = TObject;
-    using pointer = TObject*;
-    using reference = TObject&;
-    using iterator_category = forward_iterator_tag;
-  };
+  if(!plots) return;
+  Plot(plots, std::unique_ptr<PlotUtils::MnvH1D>(static_cast<PlotUtils::MnvH1D*>(hist.Clone())), stepName, prefix);
 }
 
-//Plot a step in cross section extraction.
-void Plot(PlotUtils::MnvH1D& hist, const std::string& stepName, const std::string& prefix)
+//Extract a cross section for one prefix and write it to <prefix>_crossSection.root.
+//Opens its own copies of the input files so that each prefix can run on its own thread.
+//Returns 0 on success or the same error code main() would have returned.
+int ExtractPrefix(const std::string& prefix, const std::string& dataFileName, const std::string& mcFileName, const int nIterations,
+                  const std::map<std::string, std::vector<double>>& rebinnings, const double mcPOT, const double dataPOT,
+                  const int nUnfoldWorkers, const std::string& sideband, util::PlotQueue* plots)
 {
-  TCanvas can(stepName.c_str());
-  hist.GetCVHistoWithError().Clone()->Draw();
-  can.Print((prefix + "_" + stepName + ".png").c_str());
+  std::unique_ptr<TFile> dataFile(TFile::Open(dataFileName.c_str(), "READ"));
+  if(!dataFile)
+  {
+    std::cerr << "Failed to open data file " << dataFileName << " for prefix " << prefix << ".\n";
+    return 2;
+  }
+
+  std::unique_ptr<TFile> mcFile(TFile::Open(mcFileName.c_str(), "READ"));
+  if(!mcFile)
+  {
+    std::cerr << "Failed to open MC file " << mcFileName << " for prefix " << prefix << ".\n";
+    return 3;
+  }
+
+  try
+  {
+    //When asked for a new binning, read fine-binned ingredients and rebin them
+    //before anything else happens so that every error band gets the same binning.
+    const auto newBinning = rebinnings.find(prefix);
+    const bool rebin = (newBinning != rebinnings.end());
+    TDirectoryFile* mcDir = mcFile.get();
+    TDirectoryFile* dataDir = dataFile.get();
+    if(rebin)
+    {
+      std::cout << "Rebinning " << prefix << " from its fine-binned ingredients.\n";
+      mcDir = util::GetIngredient<TDirectoryFile>(*mcFile, "fine");
+      dataDir = util::GetIngredient<TDirectoryFile>(*dataFile, "fine");
+    }
 
-  //Uncertainty summary
-  PlotUtils::MnvPlotter plotter;
-  plotter.ApplyStyle(PlotUtils::kCCQENuStyle);
-  plotter.axis_maximum = 0.4;
+    const auto get1D = [rebin, &newBinning](TDirectoryFile& dir, const std::string& name, const bool average)
+                       {
+                         auto hist = util::GetIngredient<PlotUtils::MnvH1D>(dir, name);
+                         return rebin?util::Rebin(*hist, newBinning->second, average):hist;
+                       };
+
+    //Look up every ingredient by name instead of searching keys
+    const util::Manifest mcManifest(*mcDir), dataManifest(*dataDir);
+    const auto& mcNames = mcManifest.Get(prefix);
+
+    auto flux = get1D(*mcDir, mcNames.flux, true);
+    auto folded = get1D(*dataDir, dataManifest.Get(prefix).data, false);
+    Plot(plots, *folded, "data", prefix);
+    auto migration = util::GetIngredient<PlotUtils::MnvH2D>(*mcDir, mcNames.migration);
+    if(rebin) migration = util::Rebin(*migration, newBinning->second);
+    auto effNum = get1D(*mcDir, mcNames.efficiencyNumerator, false);
+    auto effDenom = get1D(*mcDir, mcNames.efficiencyDenominator, false);
+
+    if(mcNames.fiducialNucleons.empty()) throw std::runtime_error("Failed to find a number of nucleons that matches prefix " + prefix);
+    auto nNucleons = util::GetIngredient<TParameter<double>>(*mcDir, mcNames.fiducialNucleons); //Dan: Use the same truth fiducial volume for all extractions.  The acceptance correction corrects data back to this fiducial even if the reco fiducial cut is different.
+
+    std::vector<PlotUtils::MnvH1D*> backgrounds;
+    for(const auto& name: mcNames.backgrounds) backgrounds.push_back(get1D(*mcDir, name, false));
+
+    //There are no error bands in the data, but I need somewhere to put error bands on the results I derive from it.
+    folded->AddMissingErrorBandsAndFillWithCV(*migration);
+
+    //Basing my unfolding procedure for a differential cross section on Alex's MINERvA 101 talk at https://minerva-docdb.fnal.gov/cgi-bin/private/RetrieveFile?docid=27438&filename=whatsACrossSection.pdf&version=1
+
+    //Every step that treats each universe the same way runs over all universes at once.
+    //Put every ingredient into the same layout of universes first.
+    const util::UniverseMatrix layout(*folded);
+    std::vector<util::UniverseMatrix> bkgMatrices;
+    for(const auto hist: backgrounds) bkgMatrices.emplace_back(*hist, layout);
+    std::vector<const util::UniverseMatrix*> toSubtract;
+    for(const auto& bkg: bkgMatrices) toSubtract.push_back(&bkg);
+
+    //Normalize the backgrounds to the data in a sideband universe by universe
+    if(!sideband.empty())
+    {
+      if(rebin) throw std::runtime_error("Sidebands are only filled with the original binning, so I can't normalize backgrounds to one while rebinning " + prefix);
+
+      auto mcSidebandDir = util::GetIngredient<TDirectoryFile>(*mcFile, "sidebands/" + sideband);
+      auto dataSidebandDir = util::GetIngredient<TDirectoryFile>(*dataFile, "sidebands/" + sideband);
+      const util::Manifest mcSideband(*mcSidebandDir), dataSideband(*dataSidebandDir);
+      const auto& sidebandNames = mcSideband.Get(prefix);
+
+      const util::UniverseMatrix sidebandData(*util::GetIngredient<PlotUtils::MnvH1D>(*dataSidebandDir, dataSideband.Get(prefix).data), layout),
+                                 sidebandSignal(*util::GetIngredient<PlotUtils::MnvH1D>(*mcSidebandDir, sidebandNames.selectedSignalReco), layout);
+      std::vector<util::UniverseMatrix> sidebandBkgs;
+      for(const auto& name: sidebandNames.backgrounds) sidebandBkgs.emplace_back(*util::GetIngredient<PlotUtils::MnvH1D>(*mcSidebandDir, name), layout);
+      std::vector<const util::UniverseMatrix*> sidebandBkgPtrs;
+      for(const auto& bkg: sidebandBkgs) sidebandBkgPtrs.push_back(&bkg);
+
+      const auto bkgScales = util::SidebandBackgroundScales(sidebandData, sidebandSignal, sidebandBkgPtrs, dataPOT/mcPOT);
+      std::cout << "Scaling backgrounds for " << prefix << " by " << bkgScales.front() << " in the CV to match the " << sideband << " sideband.\n";
+      for(auto& bkg: bkgMatrices) util::ScaleUniverses(bkg, bkgScales);
+    }
 
-  plotter.DrawErrorSummary(&hist);
-  can.Print((prefix + "_" + stepName + "_uncertaintySummary.png").c_str());
+    //TODO: Remove these debugging plots when done
+    if(!bkgMatrices.empty())
+    {
+      util::UniverseMatrix bkgSum(bkgMatrices.front());
+      util::SubtractBackgrounds(bkgSum, std::vector<const util::UniverseMatrix*>(std::next(toSubtract.begin()), toSubtract.end()), -1);
+      Plot(plots, std::unique_ptr<PlotUtils::MnvH1D>(bkgSum.ToMnvH1D(*folded, prefix + "_BackgroundSum")), "BackgroundSum", prefix);
+    }
 
-  plotter.DrawErrorSummary(&hist, "TR", true, true, 1e-5, false, "Other");
-  can.Print((prefix + "_" + stepName + "_otherUncertainties.png").c_str());
-}
+    for(const auto hist: backgrounds) std::cout << "Subtracting " << hist->GetName() << " scaled by " << -dataPOT/mcPOT << " from " << folded->GetName() << "\n";
+    util::UniverseMatrix subtracted(*folded, layout);
+    util::SubtractBackgrounds(subtracted, toSubtract, dataPOT/mcPOT);
+    auto bkgSubtracted = subtracted.ToMnvH1D(*folded, prefix + "_backgroundSubtracted");
+    Plot(plots, *bkgSubtracted, "backgroundSubtracted", prefix);
 
-//Unfolding function from Aaron Bercelle
-//TODO: Trim it down a little?  Remove that static?
-PlotUtils::MnvH1D* UnfoldHist( PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, int num_iter )
-{
-  static MinervaUnfold::MnvUnfold unfold;
-  PlotUtils::MnvH1D* h_unfolded = nullptr;
-
-  //bool bUnfolded = false;
-
-  TMatrixD dummyCovMatrix;
-  if(!unfold.UnfoldHisto( h_unfolded, dummyCovMatrix, h_migration, h_folded, RooUnfold::kBayes, num_iter, true, false ))
-    return nullptr;
-
-  /////////////////////////////////////////////////////////////////////////////////////////  
-  //No idea if this is still needed
-  //Probably.  This gets your stat unfolding covariance matrix
-  TMatrixD unfoldingCovMatrixOrig; 
-  int correctNbins;
-  int matrixRows;  
-  TH1D* hUnfoldedDummy  = new TH1D(h_unfolded->GetCVHistoWithStatError());
-  TH1D* hRecoDummy      = new TH1D(h_migration->ProjectionX()->GetCVHistoWithStatError());
-  TH1D* hTruthDummy     = new TH1D(h_migration->ProjectionY()->GetCVHistoWithStatError());
-  TH1D* hBGSubDataDummy = new TH1D(h_folded->GetCVHistoWithStatError());
-  TH2D* hMigrationDummy = new TH2D(h_migration->GetCVHistoWithStatError());
-  unfold.UnfoldHisto(hUnfoldedDummy, unfoldingCovMatrixOrig, hMigrationDummy, hRecoDummy, hTruthDummy, hBGSubDataDummy,RooUnfold::kBayes, num_iter);//Stupid RooUnfold.  This is dummy, we don't need iterations
-
-  correctNbins=hUnfoldedDummy->fN;
-  matrixRows=unfoldingCovMatrixOrig.GetNrows();
-  if(correctNbins!=matrixRows){
-    std::cout << "****************************************************************************" << std::endl;
-    std::cout << "*  Fixing unfolding matrix size because of RooUnfold bug. From " << matrixRows << " to " << correctNbins << std::endl;
-    std::cout << "****************************************************************************" << std::endl;
-    // It looks like this, since the extra last two bins don't have any content
-    unfoldingCovMatrixOrig.ResizeTo(correctNbins, correctNbins);
-  }
+    std::unique_ptr<TFile> outFile(TFile::Open((prefix + "_crossSection.root").c_str(), "CREATE"));
+    if(!outFile)
+    {
+      std::cerr << "Could not create a file called " << prefix + "_crossSection.root" << ".  Does it already exist?\n";
+      return 5;
+    }
 
-  for(int i=0; i<unfoldingCovMatrixOrig.GetNrows(); ++i) unfoldingCovMatrixOrig(i,i)=0;
-  delete hUnfoldedDummy;
-  delete hMigrationDummy;
-  delete hRecoDummy;
-  delete hTruthDummy;
-  delete hBGSubDataDummy;
-  h_unfolded->PushCovMatrix("unfoldingCov",unfoldingCovMatrixOrig);
+    bkgSubtracted->Write("backgroundSubtracted");
+
+    //d'Aogstini unfolding
+    auto unfolded = (nUnfoldWorkers > 1)?util::UnfoldHistParallel(bkgSubtracted, migration, nIterations, nUnfoldWorkers)
+                                        :util::UnfoldHist(bkgSubtracted, migration, nIterations);
+    if(!unfolded) throw std::runtime_error(std::string("Failed to unfold ") + folded->GetName() + " using " + migration->GetName());
+    Plot(plots, *unfolded, "unfolded", prefix);
+    unfolded->Clone()->Write("unfolded"); //TODO: Seg fault first appears when I uncomment this line
+    std::cout << "Survived writing the unfolded histogram.\n" << std::flush; //This is evidence that the problem is on the final file Write() and not unfolded->Clone()->Write().
+
+    //Efficiency correction, flux, number of targets, POT, and bin width normalization in one pass.
+    //The efficiency and efficiency-corrected matrices are just along for the ride to make plots.
+    std::vector<double> binWidths(unfolded->GetNcells());
+    for(size_t whichBin = 0; whichBin < binWidths.size(); ++whichBin) binWidths[whichBin] = unfolded->GetXaxis()->GetBinWidth(whichBin);
+
+    util::UniverseMatrix crossSectionMatrix(*unfolded);
+    const util::UniverseMatrix fluxMatrix(*flux, crossSectionMatrix),
+                               effNumMatrix(*effNum, crossSectionMatrix),
+                               effDenomMatrix(*effDenom, crossSectionMatrix);
+    util::UniverseMatrix efficiency(effNumMatrix), efficiencyCorrected(crossSectionMatrix);
+    const auto cvFactors = util::EfficiencyCorrectAndNormalize(crossSectionMatrix, &effNumMatrix, &effDenomMatrix, fluxMatrix, binWidths,
+                                                               nNucleons->GetVal(), dataPOT, &efficiency, &efficiencyCorrected);
+
+    Plot(plots, std::unique_ptr<PlotUtils::MnvH1D>(efficiency.ToMnvH1D(*effNum, prefix + "_efficiency")), "efficiency", prefix);
+    Plot(plots, std::unique_ptr<PlotUtils::MnvH1D>(efficiencyCorrected.ToMnvH1D(*unfolded, prefix + "_efficiencyCorrected")), "efficiencyCorrected", prefix);
+
+    auto crossSection = crossSectionMatrix.ToMnvH1D(*unfolded, prefix + "_crossSection");
+    util::PushScaledCovMatrices(*unfolded, *crossSection, cvFactors);
+    Plot(plots, *crossSection, "crossSection", prefix);
+    crossSection->Write("crossSection");
+    if(!util::WriteCovariances(*crossSection, "crossSection", *outFile, getenv("MNV101_CHECK_COVARIANCE") != nullptr))
+    {
+      std::cerr << "Covariance matrices for " << prefix << " disagree with MnvH1D's.\n";
+    }
 
-  /////////////////////////////////////////////////////////////////////////////////////////  
-  return h_unfolded;
-}
+    //Write a "simulated cross section" to compare to the data I just extracted.
+    //If this analysis passed its closure test, this should be the same cross section as
+    //what GENIEXSecExtract would produce.
+    util::UniverseMatrix simMatrix(*effDenom);
+    util::EfficiencyCorrectAndNormalize(simMatrix, nullptr, nullptr, util::UniverseMatrix(*flux, simMatrix), binWidths, nNucleons->GetVal(), mcPOT);
+    auto simEventRate = simMatrix.ToMnvH1D(*effDenom, prefix + "_simulatedCrossSection");
 
-//The final step of cross section extraction: normalize by flux, bin width, POT, and number of targets
-PlotUtils::MnvH1D* normalize(PlotUtils::MnvH1D* efficiencyCorrected, PlotUtils::MnvH1D* fluxIntegral, const double nNucleons, const double POT)
-{
-  efficiencyCorrected->Divide(efficiencyCorrected, fluxIntegral);
+    Plot(plots, *simEventRate, "simulatedCrossSection", prefix);
+    simEventRate->Write("simulatedCrossSection");
 
-  efficiencyCorrected->Scale(1./nNucleons/POT);
-  efficiencyCorrected->Scale(1.e4); //Flux histogram is in m^-2, but convention is to report cm^2
-  efficiencyCorrected->Scale(1., "width");
+    //Flush this prefix's results now instead of when the program exits
+    outFile->Close();
+  }
+  //Any exception stays with this prefix.  Letting one escape a worker thread would end every other prefix too.
+  catch(const std::exception& e)
+  {
+    std::cerr << "Failed to extract a cross section for prefix " << prefix << ": " << e.what() << "\n";
+    return 4;
+  }
+  catch(...)
+  {
+    std::cerr << "Failed to extract a cross section for prefix " << prefix << " because of an unknown exception.\n";
+    return 4;
+  }
 
-  return efficiencyCorrected;
+  return 0;
 }
 
 int main(const int argc, const char** argv)
@@ -139,14 +289,81 @@ int main(const int argc, const char** argv)
   #endif
 
   TH1::AddDirectory(kFALSE); //Needed so that MnvH1D gets to clean up its own MnvLatErrorBands (which are TH1Ds).
+  gROOT->SetBatch(); //Only draw to image files.  Plots are drawn on their own thread.
 
-  if(argc != 4)
+  const std::string usage = "USAGE: ExtractCrossSection <unfolding iterations> <data.root> <mc.root> [-j <nWorkers>] [-u <nUnfoldWorkers>] [-s <sideband>] [--no-plots] [<prefix>=<edge>,<edge>,...]...\n";
+  if(argc < 4)
   {
-    std::cerr << "Expected 3 arguments, but I got " << argc-1 << ".\n"
-              << "USAGE: ExtractCrossSection <unfolding iterations> <data.root> <mc.root>\n";
+    std::cerr << "Expected at least 3 arguments, but I got " << argc-1 << ".\n" << usage;
     return 1;
   }
 
+  //Prefixes to rebin from their fine-binned ingredients
+  std::map<std::string, std::vector<double>> rebinnings;
+  const size_t nCores = std::max(std::thread::hardware_concurrency(), 1u);
+  size_t nWorkers = nCores;
+  int nUnfoldWorkers = 0; //0 means pick based on nWorkers
+  bool makePlots = true;
+  std::string sideband; //Empty means don't normalize backgrounds
+  for(int whichArg = 4; whichArg < argc; ++whichArg)
+  {
+    if(std::string(argv[whichArg]) == "-j" && whichArg + 1 < argc)
+    {
+      try
+      {
+        nWorkers = std::max(std::stoi(argv[++whichArg]), 1);
+      }
+      catch(const std::exception& e)
+      {
+        std::cerr << "Failed to parse the number of workers from " << argv[whichArg] << ": " << e.what() << "\n" << usage;
+        return 1;
+      }
+      continue;
+    }
+
+    if(std::string(argv[whichArg]) == "-s" && whichArg + 1 < argc)
+    {
+      sideband = argv[++whichArg];
+      continue;
+    }
+
+    if(std::string(argv[whichArg]) == "--no-plots")
+    {
+      makePlots = false;
+      continue;
+    }
+
+    if(std::string(argv[whichArg]) == "-u" && whichArg + 1 < argc)
+    {
+      try
+      {
+        nUnfoldWorkers = std::max(std::stoi(argv[++whichArg]), 1);
+      }
+      catch(const std::exception& e)
+      {
+        std::cerr << "Failed to parse the number of unfolding workers from " << argv[whichArg] << ": " << e.what() << "\n" << usage;
+        return 1;
+      }
+      continue;
+    }
+
+    std::string prefix;
+    std::vector<double> edges;
+    if(!util::ParseBinning(argv[whichArg], prefix, edges))
+    {
+      std::cerr << "Failed to parse bin edges from " << argv[whichArg] << ".\n"
+                << usage;
+      return 1;
+    }
+    rebinnings[prefix] = edges;
+  }
+
+  //Older ROOT versions can't read files from more than one thread
+  #ifndef NCINTEX
+  nWorkers = 1;
+  nUnfoldWorkers = 1;
+  #endif
+
   const int nIterations = std::stoi(argv[1]);
   auto dataFile = TFile::Open(argv[2], "READ");
   if(!dataFile)
@@ -163,113 +380,62 @@ int main(const int argc, const char** argv)
   }
 
   std::vector<std::string> crossSectionPrefixes;
-  for(auto key: *dataFile->GetListOfKeys())
+  double mcPOT = 0, dataPOT = 0;
+  try
   {
-    const std::string keyName = key->GetName();
-    const size_t endOfPrefix = keyName.find("_data");
-    if(endOfPrefix != std::string::npos) crossSectionPrefixes.push_back(keyName.substr(0, endOfPrefix));
+    const util::Manifest dataManifest(*dataFile), mcManifest(*mcFile);
+    crossSectionPrefixes = dataManifest.GetVariables();
+    mcPOT = mcManifest.GetPOT();
+    dataPOT = dataManifest.GetPOT();
+    if(!dataManifest.WasWritten()) std::cout << "No Manifest in " << argv[2] << ".  Searching its keys for ingredients instead.\n";
   }
-
-  const double mcPOT = util::GetIngredient<TParameter<double>>(*mcFile, "POTUsed")->GetVal(),
-               dataPOT = util::GetIngredient<TParameter<double>>(*dataFile, "POTUsed")->GetVal();
-
-  for(const auto& prefix: crossSectionPrefixes)
+  catch(const std::runtime_error& e)
   {
-    try
-    {
-      auto flux = util::GetIngredient<PlotUtils::MnvH1D>(*mcFile, "reweightedflux_integrated", prefix);
-      auto folded = util::GetIngredient<PlotUtils::MnvH1D>(*dataFile, "data", prefix);
-      Plot(*folded, "data", prefix);
-      auto migration = util::GetIngredient<PlotUtils::MnvH2D>(*mcFile, "migration", prefix);
-      auto effNum = util::GetIngredient<PlotUtils::MnvH1D>(*mcFile, "efficiency_numerator", prefix);
-      auto effDenom = util::GetIngredient<PlotUtils::MnvH1D>(*mcFile, "efficiency_denominator", prefix);
-      auto simEventRate = effDenom->Clone(); //Make a copy for later
-
-      const auto fiducialFound = std::find_if(mcFile->GetListOfKeys()->begin(), mcFile->GetListOfKeys()->end(),
-                                              [&prefix](const auto key)
-                                              {
-                                                const std::string keyName = key->GetName();
-                                                const size_t fiducialEnd = keyName.find("_fiducial_nucleons");
-                                                return (fiducialEnd != std::string::npos) && (prefix.find(keyName.substr(0, fiducialEnd)) != std::string::npos);
-                                              });
-      if(fiducialFound == mcFile->GetListOfKeys()->end()) throw std::runtime_error("Failed to find a number of nucleons that matches prefix " + prefix);
-
-      auto nNucleons = util::GetIngredient<TParameter<double>>(*mcFile, (*fiducialFound)->GetName()); //Dan: Use the same truth fiducial volume for all extractions.  The acceptance correction corrects data back to this fiducial even if the reco fiducial cut is different.
-
-      //Look for backgrounds with <prefix>_<analysis>_Background_<name>
-      std::vector<PlotUtils::MnvH1D*> backgrounds;
-      for(auto key: *mcFile->GetListOfKeys())
-      {
-        if(std::string(key->GetName()).find(prefix + "_background_") != std::string::npos)
-        {
-          backgrounds.push_back(util::GetIngredient<PlotUtils::MnvH1D>(*mcFile, key->GetName()));
-        }
-      }
+    std::cerr << "Failed to read the list of ingredients: " << e.what() << "\n";
+    return 4;
+  }
 
-      //There are no error bands in the data, but I need somewhere to put error bands on the results I derive from it.
-      folded->AddMissingErrorBandsAndFillWithCV(*migration);
-
-      //Basing my unfolding procedure for a differential cross section on Alex's MINERvA 101 talk at https://minerva-docdb.fnal.gov/cgi-bin/private/RetrieveFile?docid=27438&filename=whatsACrossSection.pdf&version=1
-
-      //TODO: Remove these debugging plots when done
-      auto toSubtract = std::accumulate(std::next(backgrounds.begin()), backgrounds.end(), (*backgrounds.begin())->Clone(),
-                                        [](auto sum, const auto hist)
-                                        {
-                                          sum->Add(hist);
-                                          return sum;
-                                        });
-      Plot(*toSubtract, "BackgroundSum", prefix);
-
-      auto bkgSubtracted = std::accumulate(backgrounds.begin(), backgrounds.end(), folded->Clone(),
-                                           [mcPOT, dataPOT](auto sum, const auto hist)
-                                           {
-                                             std::cout << "Subtracting " << hist->GetName() << " scaled by " << -dataPOT/mcPOT << " from " << sum->GetName() << "\n";
-                                             sum->Add(hist, -dataPOT/mcPOT);
-                                             return sum;
-                                           });
-      Plot(*bkgSubtracted, "backgroundSubtracted", prefix);
-
-      auto outFile = TFile::Open((prefix + "_crossSection.root").c_str(), "CREATE");
-      if(!outFile)
-      {
-        std::cerr << "Could not create a file called " << prefix + "_crossSection.root" << ".  Does it already exist?\n";
-        return 5;
-      }
+  nWorkers = std::min(nWorkers, crossSectionPrefixes.size());
+  if(nUnfoldWorkers == 0) nUnfoldWorkers = std::max<int>(nCores / std::max<size_t>(nWorkers, 1), 1);
+  #ifdef NCINTEX
+  if(nWorkers > 1 || nUnfoldWorkers > 1 || makePlots) ROOT::EnableThreadSafety();
+  #endif
 
-      bkgSubtracted->Write("backgroundSubtracted");
-
-      //d'Aogstini unfolding
-      auto unfolded = UnfoldHist(bkgSubtracted, migration, nIterations);
-      if(!unfolded) throw std::runtime_error(std::string("Failed to unfold ") + folded->GetName() + " using " + migration->GetName());
-      Plot(*unfolded, "unfolded", prefix);
-      unfolded->Clone()->Write("unfolded"); //TODO: Seg fault first appears when I uncomment this line
-      std::cout << "Survived writing the unfolded histogram.\n" << std::flush; //This is evidence that the problem is on the final file Write() and not unfolded->Clone()->Write().
-
-      effNum->Divide(effNum, effDenom); //Only the 2 parameter version of MnvH1D::Divide()
-                                        //handles systematics correctly.
-      Plot(*effNum, "efficiency", prefix);
-
-      unfolded->Divide(unfolded, effNum);
-      Plot(*unfolded, "efficiencyCorrected", prefix);
-
-      auto crossSection = normalize(unfolded, flux, nNucleons->GetVal(), dataPOT);
-      Plot(*crossSection, "crossSection", prefix);
-      crossSection->Clone()->Write("crossSection");
-
-      //Write a "simulated cross section" to compare to the data I just extracted.
-      //If this analysis passed its closure test, this should be the same cross section as
-      //what GENIEXSecExtract would produce.
-      normalize(simEventRate, flux, nNucleons->GetVal(), mcPOT);
-      
-      Plot(*simEventRate, "simulatedCrossSection", prefix);
-      simEventRate->Write("simulatedCrossSection");
-    }
-    catch(const std::runtime_error& e)
+  //Plots are drawn in the background.  Older ROOT versions draw them right away instead.
+  std::unique_ptr<util::PlotQueue> plots;
+  #ifndef NCINTEX
+  if(makePlots) plots.reset(new util::PlotQueue(false));
+  #else
+  if(makePlots) plots.reset(new util::PlotQueue());
+  #endif
+
+  //Each worker takes the next prefix nobody has started yet
+  std::vector<int> results(crossSectionPrefixes.size(), 0);
+  std::atomic<size_t> nextPrefix(0);
+  const auto work = [&]()
+                    {
+                      for(size_t whichPrefix = nextPrefix++; whichPrefix < crossSectionPrefixes.size(); whichPrefix = nextPrefix++)
+                      {
+                        results[whichPrefix] = ExtractPrefix(crossSectionPrefixes[whichPrefix], argv[2], argv[3], nIterations, rebinnings, mcPOT, dataPOT, nUnfoldWorkers, sideband, plots.get());
+                      }
+                    };
+
+  std::vector<std::thread> workers;
+  for(size_t whichWorker = 1; whichWorker < nWorkers; ++whichWorker) workers.emplace_back(work);
+  work();
+  for(auto& worker: workers) worker.join();
+  plots.reset(); //Wait for the last plots to be drawn
+
+  //Report every prefix that failed.  Return the first failure's code.
+  int status = 0;
+  for(size_t whichPrefix = 0; whichPrefix < crossSectionPrefixes.size(); ++whichPrefix)
+  {
+    if(results[whichPrefix] != 0)
     {
-      std::cerr << "Failed to extra a cross section for prefix " << prefix << ": " << e.what() << "\n";
-      return 4;
+      std::cerr << "Cross section extraction failed for " << crossSectionPrefixes[whichPrefix] << " with code " << results[whichPrefix] << ".\n";
+      if(status == 0) status = results[whichPrefix];
     }
   }
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,423 @@
+//File: HistogramSelectedEvents.cpp
+//Brief: Second stage of event selection.  Turns the EventStore that runEventLoop writes
+//       when MNV101_EVENT_STORE is set into the same histograms that runEventLoop
+//       would have produced.  Variables can be given new bin edges on the command
+//       line, so rebinning studies don't have to reread and reweight AnaTuples.
+
+#define MC_OUT_FILE_NAME "runEventLoopMC.root"
+#define DATA_OUT_FILE_NAME "runEventLoopData.root"
+
+#define USAGE \
+"\n*** USAGE ***\n"\
+"HistogramSelectedEvents <eventStore.root> [<variable>=<edge>,<edge>,...]...\n\n"\
+"*** Explanation ***\n"\
+"Fill the histograms runEventLoop makes from the selected events it saved when\n"\
+"MNV101_EVENT_STORE was set.  Each optional argument replaces the bin edges for\n"\
+"the Variable with that name.  For example, pTmu=0,0.25,0.5,1,2.5,4.5\n\n"\
+"*** Output ***\n"\
+"Produces " MC_OUT_FILE_NAME " and " DATA_OUT_FILE_NAME " just like runEventLoop\n"\
+"for the ExtractCrossSection program also built by this package.\n\n"\
+"*** Environment Variables ***\n"\
+"If MNV101_FLUX_CACHE is set to a directory, flux integrals are saved there and\n"\
+"reused by later runs with the same playlist, flux settings, binning, and flux\n"\
+"files.\n\n"\
+"*** Return Codes ***\n"\
+"0 indicates success.  Any other return code indicates that histograms should\n"\
+"not be used.  Error messages about what went wrong will be printed to stderr.\n"
+
+enum ErrorCodes
+{
+  success = 0,
+  badCmdLine = 1,
+  badInputFile = 2,
+  badFileRead = 3,
+  badOutputFile = 4
+};
+
+//Includes from this package
+#include "util/EventStore.h"
+#include "util/GetFluxIntegral.h"
+#include "util/GetIngredient.h"
+#include "util/SafeROOTName.h"
+#include "util/Rebin.h"
+#include "util/Manifest.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#include "PlotUtils/MnvH2D.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+#include "TParameter.h"
+#include "TNamed.h"
+
+//c++ includes
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+
+namespace
+{
+  //Where each universe index in an EventStore goes
+  struct UniverseInfo
+  {
+    std::string band;
+    int whichUniverse;
+    bool isLateral;
+  };
+
+  //Error band layout shared by every MC histogram
+  struct Band
+  {
+    std::string name;
+    int nUniverses;
+    bool isLateral;
+  };
+
+  template <class MNVHIST>
+  MNVHIST* AddErrorBands(MNVHIST* hist, const std::vector<Band>& bands)
+  {
+    for(const auto& band: bands)
+    {
+      if(band.isLateral) hist->AddLatErrorBand(band.name, band.nUniverses);
+      else hist->AddVertErrorBand(band.name, band.nUniverses);
+    }
+    return hist;
+  }
+
+  //Look up each universe's histogram once instead of once per Fill()
+  template <class BASE, class MNVHIST>
+  std::vector<BASE*> UniverseTable(MNVHIST& hist, const std::vector<UniverseInfo>& univs)
+  {
+    std::vector<BASE*> table;
+    for(const auto& univ: univs)
+    {
+      if(univ.band == "cv") table.push_back(&hist);
+      else if(univ.isLateral) table.push_back(hist.GetLatErrorBand(univ.band)->GetHist(univ.whichUniverse));
+      else table.push_back(hist.GetVertErrorBand(univ.band)->GetHist(univ.whichUniverse));
+    }
+    return table;
+  }
+
+  //Makes sure that all error bands know about the CV like HistWrapper::SyncCVHistos()
+  template <class BASE, class MNVHIST>
+  void SyncCVHistos(MNVHIST& hist)
+  {
+    for(const auto& name: hist.GetVertErrorBandNames()) hist.GetVertErrorBand(name)->BASE::operator=(hist);
+    for(const auto& name: hist.GetLatErrorBandNames()) hist.GetLatErrorBand(name)->BASE::operator=(hist);
+  }
+
+  //Every histogram runEventLoop makes for a Variable along with lookup tables for filling them
+  struct VariableHists
+  {
+    VariableHists(const std::string& name, const std::vector<double>& bins, const std::vector<Band>& bands, const std::vector<UniverseInfo>& univs): fName(name)
+    {
+      const int nBins = bins.size() - 1;
+      const std::map<int, std::string> bkgLabels = {{0, "NC"},
+                                                    {1, "Wrong_Sign"}};
+      for(const auto& label: bkgLabels)
+      {
+        backgrounds[label.first] = mc(util::SafeROOTName(name + "_background_" + label.second), label.second + ";" + name, bins, bands);
+      }
+      bkgOther = mc(name + "_background_Other", "Other;" + name, bins, bands);
+
+      effNum = mc(name + "_efficiency_numerator", name, bins, bands);
+      effDenom = mc(name + "_efficiency_denominator", name, bins, bands);
+      selectedSignalReco = mc(name + "_selected_signal_reco", name, bins, bands);
+      selectedMCReco = mc(name + "_selected_mc_reco", name, bins, bands);
+      migration = AddErrorBands(new PlotUtils::MnvH2D((name + "_migration").c_str(), name.c_str(), nBins, bins.data(), nBins, bins.data()), bands);
+      data = new PlotUtils::MnvH1D((name + "_data").c_str(), name.c_str(), nBins, bins.data());
+
+      for(const auto& bkg: backgrounds) bkgTables[bkg.first] = UniverseTable<TH1D>(*bkg.second, univs);
+      bkgOtherTable = UniverseTable<TH1D>(*bkgOther, univs);
+      effNumTable = UniverseTable<TH1D>(*effNum, univs);
+      effDenomTable = UniverseTable<TH1D>(*effDenom, univs);
+      selectedSignalRecoTable = UniverseTable<TH1D>(*selectedSignalReco, univs);
+      selectedMCRecoTable = UniverseTable<TH1D>(*selectedMCReco, univs);
+      migrationTable = UniverseTable<TH2D>(*migration, univs);
+    }
+
+    void FillSelected(const int univ, const int category, const double reco, const double truth, const double weight)
+    {
+      selectedMCRecoTable[univ]->Fill(reco, weight);
+      if(category == util::eventStore::signal)
+      {
+        effNumTable[univ]->Fill(truth, weight);
+        migrationTable[univ]->Fill(reco, truth, weight);
+        selectedSignalRecoTable[univ]->Fill(reco, weight);
+      }
+      else
+      {
+        const auto found = bkgTables.find(category);
+        if(found == bkgTables.end()) bkgOtherTable[univ]->Fill(reco, weight);
+        else found->second[univ]->Fill(reco, weight);
+      }
+    }
+
+    void WriteMC(TFile& file)
+    {
+      file.cd();
+      for(auto& bkg: backgrounds) writeMC(*bkg.second);
+      writeMC(*bkgOther);
+      writeMC(*effNum);
+      writeMC(*effDenom);
+      SyncCVHistos<TH2D>(*migration);
+      migration->Write();
+      writeMC(*selectedSignalReco);
+      writeMC(*selectedMCReco, fName + "_data"); //Make this histogram look just like the data for closure tests
+    }
+
+    //Names of everything WriteMC() writes plus the flux and number of nucleons main() writes
+    util::Manifest::Entry GetMCManifestEntry() const
+    {
+      util::Manifest::Entry entry;
+      entry.variable = fName;
+      entry.data = fName + "_data";
+      entry.efficiencyNumerator = effNum->GetName();
+      entry.efficiencyDenominator = effDenom->GetName();
+      entry.migration = migration->GetName();
+      entry.selectedSignalReco = selectedSignalReco->GetName();
+      entry.flux = fName + "_reweightedflux_integrated";
+      entry.fiducialNucleons = fName + "_fiducial_nucleons";
+      for(const auto& bkg: backgrounds) entry.backgrounds.push_back(bkg.second->GetName());
+      entry.backgrounds.push_back(bkgOther->GetName());
+      return entry;
+    }
+
+    util::Manifest::Entry GetDataManifestEntry() const
+    {
+      util::Manifest::Entry entry;
+      entry.variable = fName;
+      entry.data = data->GetName();
+      return entry;
+    }
+
+    std::string fName;
+
+    std::map<int, PlotUtils::MnvH1D*> backgrounds;
+    PlotUtils::MnvH1D* bkgOther;
+    PlotUtils::MnvH1D* effNum;
+    PlotUtils::MnvH1D* effDenom;
+    PlotUtils::MnvH1D* selectedSignalReco;
+    PlotUtils::MnvH1D* selectedMCReco;
+    PlotUtils::MnvH2D* migration;
+    PlotUtils::MnvH1D* data;
+
+    std::map<int, std::vector<TH1D*>> bkgTables;
+    std::vector<TH1D*> bkgOtherTable, effNumTable, effDenomTable, selectedSignalRecoTable, selectedMCRecoTable;
+    std::vector<TH2D*> migrationTable;
+
+    private:
+      static PlotUtils::MnvH1D* mc(const std::string& name, const std::string& title, const std::vector<double>& bins, const std::vector<Band>& bands)
+      {
+        return AddErrorBands(new PlotUtils::MnvH1D(name.c_str(), title.c_str(), bins.size() - 1, bins.data()), bands);
+      }
+
+      static void writeMC(PlotUtils::MnvH1D& hist, const std::string& name = "")
+      {
+        SyncCVHistos<TH1D>(hist);
+        if(name.empty()) hist.Write();
+        else hist.Write(name.c_str());
+      }
+  };
+}
+
+int main(const int argc, const char** argv)
+{
+  TH1::AddDirectory(false);
+
+  if(argc < 2)
+  {
+    std::cerr << "Expected at least 1 argument, but got " << argc - 1 << "\n" << USAGE << "\n";
+    return badCmdLine;
+  }
+
+  std::map<std::string, std::vector<double>> newBinning;
+  for(int whichArg = 2; whichArg < argc; ++whichArg)
+  {
+    std::string varName;
+    std::vector<double> bins;
+    if(!util::ParseBinning(argv[whichArg], varName, bins))
+    {
+      std::cerr << "Failed to parse bin edges from " << argv[whichArg] << "\n" << USAGE << "\n";
+      return badCmdLine;
+    }
+    newBinning[varName] = bins;
+  }
+
+  auto storeFile = TFile::Open(argv[1], "READ");
+  if(!storeFile)
+  {
+    std::cerr << "Failed to open an event store named " << argv[1] << "\n" << USAGE << "\n";
+    return badInputFile;
+  }
+
+  try
+  {
+    //Universe layout
+    auto univTree = util::GetIngredient<TTree>(*storeFile, util::eventStore::universeTree);
+    std::string* bandName = nullptr;
+    int whichUniverse = 0;
+    bool isLateral = false;
+    univTree->SetBranchAddress("band", &bandName);
+    univTree->SetBranchAddress("whichUniverse", &whichUniverse);
+    univTree->SetBranchAddress("isLateral", &isLateral);
+
+    std::vector<UniverseInfo> univs;
+    std::vector<Band> bands;
+    for(Long64_t entry = 0; entry < univTree->GetEntries(); ++entry)
+    {
+      univTree->GetEntry(entry);
+      univs.push_back(UniverseInfo{*bandName, whichUniverse, isLateral});
+
+      if(*bandName == "cv") continue;
+      if(bands.empty() || bands.back().name != *bandName) bands.push_back(Band{*bandName, 0, isLateral});
+      ++bands.back().nUniverses;
+    }
+
+    //Variables and their binning
+    auto varTree = util::GetIngredient<TTree>(*storeFile, util::eventStore::variableTree);
+    std::string* varName = nullptr;
+    std::vector<double>* bins = nullptr;
+    varTree->SetBranchAddress("name", &varName);
+    varTree->SetBranchAddress("bins", &bins);
+
+    std::vector<VariableHists*> vars;
+    for(Long64_t entry = 0; entry < varTree->GetEntries(); ++entry)
+    {
+      varTree->GetEntry(entry);
+      auto found = newBinning.find(*varName);
+      if(found != newBinning.end())
+      {
+        std::cout << "Rebinning " << *varName << " with " << found->second.size() - 1 << " bins.\n";
+        vars.push_back(new VariableHists(*varName, found->second, bands, univs));
+        newBinning.erase(found);
+      }
+      else vars.push_back(new VariableHists(*varName, *bins, bands, univs));
+    }
+
+    for(const auto& unused: newBinning) std::cerr << "Warning: no Variable named " << unused.first << " to rebin.\n";
+
+    const size_t nVars = vars.size();
+
+    //MC reco
+    auto selected = util::GetIngredient<TTree>(*storeFile, util::eventStore::selectedTree);
+    std::vector<int>* universe = nullptr, *category = nullptr, *kinematicsIndex = nullptr;
+    std::vector<double>* weight = nullptr, *kinematics = nullptr;
+    selected->SetBranchAddress("universe", &universe);
+    selected->SetBranchAddress("weight", &weight);
+    selected->SetBranchAddress("category", &category);
+    selected->SetBranchAddress("kinematicsIndex", &kinematicsIndex);
+    selected->SetBranchAddress("kinematics", &kinematics);
+
+    std::cout << "Filling selected MC...\n";
+    for(Long64_t entry = 0; entry < selected->GetEntries(); ++entry)
+    {
+      selected->GetEntry(entry);
+      for(size_t whichUniv = 0; whichUniv < universe->size(); ++whichUniv)
+      {
+        const double* set = kinematics->data() + (*kinematicsIndex)[whichUniv] * 2 * nVars;
+        for(size_t whichVar = 0; whichVar < nVars; ++whichVar)
+        {
+          vars[whichVar]->FillSelected((*universe)[whichUniv], (*category)[whichUniv], set[whichVar], set[nVars + whichVar], (*weight)[whichUniv]);
+        }
+      }
+    }
+
+    //Efficiency denominator
+    auto effDenom = util::GetIngredient<TTree>(*storeFile, util::eventStore::effDenomTree);
+    effDenom->SetBranchAddress("universe", &universe);
+    effDenom->SetBranchAddress("weight", &weight);
+    effDenom->SetBranchAddress("kinematicsIndex", &kinematicsIndex);
+    effDenom->SetBranchAddress("kinematics", &kinematics);
+
+    std::cout << "Filling efficiency denominator...\n";
+    for(Long64_t entry = 0; entry < effDenom->GetEntries(); ++entry)
+    {
+      effDenom->GetEntry(entry);
+      for(size_t whichUniv = 0; whichUniv < universe->size(); ++whichUniv)
+      {
+        const double* set = kinematics->data() + (*kinematicsIndex)[whichUniv] * nVars;
+        for(size_t whichVar = 0; whichVar < nVars; ++whichVar)
+        {
+          vars[whichVar]->effDenomTable[(*universe)[whichUniv]]->Fill(set[whichVar], (*weight)[whichUniv]);
+        }
+      }
+    }
+
+    //Data
+    auto data = util::GetIngredient<TTree>(*storeFile, util::eventStore::dataTree);
+    data->SetBranchAddress("kinematics", &kinematics);
+
+    std::cout << "Filling data...\n";
+    for(Long64_t entry = 0; entry < data->GetEntries(); ++entry)
+    {
+      data->GetEntry(entry);
+      for(size_t whichVar = 0; whichVar < nVars; ++whichVar) vars[whichVar]->data->Fill((*kinematics)[whichVar]);
+    }
+
+    //Write MC results
+    const double mcPOT = util::GetIngredient<TParameter<double>>(*storeFile, "MCPOTUsed")->GetVal(),
+                 dataPOT = util::GetIngredient<TParameter<double>>(*storeFile, "DataPOTUsed")->GetVal(),
+                 nNucleons = util::GetIngredient<TParameter<double>>(*storeFile, "fiducial_nucleons")->GetVal();
+    const std::string playlist = util::GetIngredient<TNamed>(*storeFile, "playlist")->GetTitle();
+    const int nuPDG = util::GetIngredient<TParameter<int>>(*storeFile, "AnalysisNuPDG")->GetVal(),
+              nFluxUniverses = util::GetIngredient<TParameter<int>>(*storeFile, "NFluxUniverses")->GetVal();
+    const bool useNuEConstraint = util::GetIngredient<TParameter<bool>>(*storeFile, "NuEConstraint")->GetVal();
+
+    TFile* mcOutDir = TFile::Open(MC_OUT_FILE_NAME, "RECREATE");
+    if(!mcOutDir)
+    {
+      std::cerr << "Failed to open a file named " << MC_OUT_FILE_NAME << " in the current directory for writing histograms.\n";
+      return badOutputFile;
+    }
+
+    for(auto& var: vars) var->WriteMC(*mcOutDir);
+
+    //Protons On Target
+    auto mcPOTParam = new TParameter<double>("POTUsed", mcPOT);
+    mcPOTParam->Write();
+
+    for(const auto& var: vars)
+    {
+      util::GetFluxIntegral(playlist, nuPDG, useNuEConstraint, nFluxUniverses, var->effNum)->Write((var->fName + "_reweightedflux_integrated").c_str());
+      auto nNucleonsParam = new TParameter<double>((var->fName + "_fiducial_nucleons").c_str(), nNucleons);
+      nNucleonsParam->Write();
+    }
+
+    std::vector<util::Manifest::Entry> mcEntries;
+    for(const auto& var: vars) mcEntries.push_back(var->GetMCManifestEntry());
+    util::Manifest::Write(*mcOutDir, mcEntries, mcPOT);
+
+    //Write data results
+    TFile* dataOutDir = TFile::Open(DATA_OUT_FILE_NAME, "RECREATE");
+    if(!dataOutDir)
+    {
+      std::cerr << "Failed to open a file named " << DATA_OUT_FILE_NAME << " in the current directory for writing histograms.\n";
+      return badOutputFile;
+    }
+
+    for(auto& var: vars) var->data->Write();
+
+    auto dataPOTParam = new TParameter<double>("POTUsed", dataPOT);
+    dataPOTParam->Write();
+
+    std::vector<util::Manifest::Entry> dataEntries;
+    for(const auto& var: vars) dataEntries.push_back(var->GetDataManifestEntry());
+    util::Manifest::Write(*dataOutDir, dataEntries, dataPOT);
+
+    std::cout << "Success" << std::endl;
+  }
+  catch(const std::runtime_error& e)
+  {
+    std::cerr << "Failed to read event store " << argv[1] << ": " << e.what() << "\n";
+    return badFileRead;
+  }
+
+  return success;
+}
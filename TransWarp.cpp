@@ -0,0 +1,314 @@
+//File: TransWarp.cpp
+//Brief: Warping study for choosing the number of unfolding iterations.  Unfolds
+//       statistical fluctuations of a warped "data" sample with the CV migration
+//       matrix and compares each one to the warped truth with a chi2.  Does the same
+//       job as TransWarpExtraction from UnfoldUtils, but every iteration count comes
+//       out of a single pass of d'Agostini iterations per universe instead of
+//       unfolding from scratch for each iteration count.
+//
+//Usage: TransWarp --output_file <out.root> --data <reco> --data_file <warped.root>
+//                 --data_truth <truth> --data_truth_file <warped.root>
+//                 --migration <migration> --migration_file <mc.root>
+//                 --truth <truth> --truth_file <mc.root>
+//                 --num_iter <n>,<n>,... [--num_uni <nUniverses>] [--seed <seed>]
+//
+//       The reco distribution is the x projection of the migration matrix, so
+//       TransWarpExtraction's --reco and --reco_file aren't needed and are rejected
+//       like any other unknown option.  --seed defaults to 1 so that a study can be
+//       reproduced.  --seed 0 picks a seed from the clock like TRandom3 does.
+//
+//       Set MNV101_CHECK_UNFOLDING to unfold the warped data with MnvUnfold too and
+//       fail if BayesUnfolder disagrees with it for any iteration count.
+
+//util includes
+#include "util/GetIngredient.h"
+#include "util/Unfold.h"
+
+//ROOT includes
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TFile.h"
+#include "TMatrixD.h"
+#include "TDecompSVD.h"
+#include "TRandom3.h"
+#include "TParameter.h"
+
+//Cintex is only needed for older ROOT versions like the GPVMs.
+//Let CMake decide whether it's needed.
+#ifndef NCINTEX
+#include "Cintex/Cintex.h"
+#endif
+
+//c++ includes
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+//Relative to the largest unfolded bin
+constexpr double maxUnfoldingDiff = 1e-6;
+
+#define USAGE "USAGE: TransWarp --output_file <out.root> --data <reco> --data_file <warped.root> --data_truth <truth> --data_truth_file <warped.root> --migration <migration> --migration_file <mc.root> --truth <truth> --truth_file <mc.root> --num_iter <n>,<n>,... [--num_uni <nUniverses>] [--seed <seed>]\n"
+
+namespace
+{
+  //Read a TH1D or TH2D, which might really be an MnvH1D or MnvH2D, out of fileName
+  template <class HIST>
+  HIST* ReadHist(const std::string& fileName, const std::string& histName)
+  {
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+    if(!file) throw std::runtime_error("Failed to open " + fileName);
+
+    auto hist = static_cast<HIST*>(util::GetIngredient<HIST>(*file, histName)->Clone());
+    hist->SetDirectory(nullptr);
+    return hist;
+  }
+
+  std::vector<double> Contents(const TH1& hist)
+  {
+    std::vector<double> contents(hist.GetNcells());
+    for(int whichBin = 0; whichBin < hist.GetNcells(); ++whichBin) contents[whichBin] = hist.GetBinContent(whichBin);
+    return contents;
+  }
+
+  //Chi2 between two sets of bin contents using only the bins inside the histogram's range
+  double Chi2(const std::vector<double>& unfolded, const std::vector<double>& truth, const TMatrixD& invCov)
+  {
+    const int nBins = invCov.GetNrows();
+    double chi2 = 0;
+    for(int row = 0; row < nBins; ++row)
+    {
+      for(int col = 0; col < nBins; ++col) chi2 += (unfolded[row + 1] - truth[row + 1]) * invCov(row, col) * (unfolded[col + 1] - truth[col + 1]);
+    }
+    return chi2;
+  }
+}
+
+int main(const int argc, const char** argv)
+{
+  #ifndef NCINTEX
+  ROOT::Cintex::Cintex::Enable(); //Needed to look up dictionaries for PlotUtils classes like MnvH1D
+  #endif
+
+  TH1::AddDirectory(kFALSE);
+
+  //Command line options work the same way as TransWarpExtraction's
+  const std::vector<std::string> required = {"--output_file", "--data", "--data_file", "--data_truth", "--data_truth_file", "--migration", "--migration_file", "--truth", "--truth_file", "--num_iter"};
+  std::map<std::string, std::string> options = {{"--num_uni", "100"}, {"--seed", "1"}};
+  if(argc % 2 == 0)
+  {
+    std::cerr << "Option " << argv[argc - 1] << " is missing a value.\n" << USAGE;
+    return 1;
+  }
+  for(int whichArg = 1; whichArg + 1 < argc; whichArg += 2)
+  {
+    const std::string option = argv[whichArg];
+    if(options.count(option) == 0 && std::find(required.begin(), required.end(), option) == required.end())
+    {
+      std::cerr << "Unknown option " << option << ".\n" << USAGE;
+      return 1;
+    }
+    options[option] = argv[whichArg + 1];
+  }
+
+  for(const auto& option: required)
+  {
+    if(options.count(option) == 0)
+    {
+      std::cerr << "Missing required option " << option << ".\n" << USAGE;
+      return 1;
+    }
+  }
+
+  std::vector<int> iterations;
+  std::stringstream iterList(options["--num_iter"]);
+  for(std::string iter; std::getline(iterList, iter, ',');)
+  {
+    try { iterations.push_back(std::stoi(iter)); }
+    catch(const std::exception& /*e*/)
+    {
+      std::cerr << "Failed to parse a number of iterations from " << iter << ".\n" << USAGE;
+      return 1;
+    }
+  }
+  std::sort(iterations.begin(), iterations.end());
+  iterations.erase(std::unique(iterations.begin(), iterations.end()), iterations.end());
+  if(iterations.empty() || iterations.front() < 1)
+  {
+    std::cerr << "Numbers of iterations must be positive.\n" << USAGE;
+    return 1;
+  }
+
+  int nUniverses = 0;
+  unsigned long seed = 0;
+  try
+  {
+    nUniverses = std::stoi(options["--num_uni"]);
+    seed = std::stoul(options["--seed"]);
+  }
+  catch(const std::exception& /*e*/)
+  {
+    std::cerr << "Failed to parse --num_uni " << options["--num_uni"] << " or --seed " << options["--seed"] << ".\n" << USAGE;
+    return 1;
+  }
+  if(nUniverses < 2)
+  {
+    std::cerr << "Need at least 2 universes to estimate a covariance matrix.\n" << USAGE;
+    return 1;
+  }
+
+  TH1D* data = nullptr, *dataTruth = nullptr, *mcTruth = nullptr;
+  TH2D* migration = nullptr;
+  try
+  {
+    data = ReadHist<TH1D>(options["--data_file"], options["--data"]);
+    dataTruth = ReadHist<TH1D>(options["--data_truth_file"], options["--data_truth"]);
+    migration = ReadHist<TH2D>(options["--migration_file"], options["--migration"]);
+    mcTruth = ReadHist<TH1D>(options["--truth_file"], options["--truth"]);
+  }
+  catch(const std::runtime_error& e)
+  {
+    std::cerr << "Failed to read inputs: " << e.what() << "\n";
+    return 2;
+  }
+
+  if(dataTruth->GetNbinsX() != migration->GetNbinsY())
+  {
+    std::cerr << options["--data_truth"] << " doesn't have the same binning as the truth axis of " << options["--migration"] << ".\n";
+    return 2;
+  }
+
+  const std::vector<double> truthContents = Contents(*dataTruth);
+  const int nTruthBins = dataTruth->GetNbinsX();
+
+  //Statistical universes fluctuate each reco bin of the data independently.
+  //unfolded[universe][iteration] has the unfolded bin contents.
+  std::vector<std::vector<double>> cv;
+  std::vector<std::vector<std::vector<double>>> unfolded;
+  try
+  {
+    //The response is the same for every universe
+    const util::BayesUnfolder unfolder(*migration, *mcTruth);
+    cv = unfolder.Scan(Contents(*data), iterations);
+
+    if(getenv("MNV101_CHECK_UNFOLDING"))
+    {
+      const double diff = util::CompareToMnvUnfold(*migration, *mcTruth, *data, iterations);
+      std::cout << "BayesUnfolder differs from MnvUnfold by at most " << diff << " of the largest unfolded bin.\n";
+      if(diff > maxUnfoldingDiff)
+      {
+        std::cerr << "BayesUnfolder disagrees with MnvUnfold by more than " << maxUnfoldingDiff << ".  Iteration counts from this study might not carry over to ExtractCrossSection.\n";
+        return 3;
+      }
+    }
+
+    TRandom3 rand(seed);
+    unfolded.reserve(nUniverses);
+    for(int whichUniv = 0; whichUniv < nUniverses; ++whichUniv)
+    {
+      std::vector<double> fluctuated = Contents(*data);
+      for(auto& content: fluctuated) content = rand.Poisson(std::max(content, 0.));
+      unfolded.push_back(unfolder.Scan(fluctuated, iterations));
+    }
+  }
+  catch(const std::runtime_error& e)
+  {
+    std::cerr << "Failed to unfold: " << e.what() << "\n";
+    return 3;
+  }
+
+  auto outFile = TFile::Open(options["--output_file"].c_str(), "RECREATE");
+  if(!outFile)
+  {
+    std::cerr << "Failed to create output file " << options["--output_file"] << ".\n";
+    return 4;
+  }
+
+  auto inputDir = outFile->mkdir("Input_Hists");
+  inputDir->cd();
+  data->Write("h_data");
+  dataTruth->Write("h_data_truth");
+  migration->ProjectionX("h_mc_reco", 0, -1)->Write();
+  mcTruth->Write("h_mc_truth");
+  migration->Write("h_migration");
+
+  //Chi2 vs. iteration summaries
+  const int maxIter = iterations.back();
+  TH2D chi2VsIter("h_chi2_modelData_trueData_iter_chi2", "Warped data unfolded;Iterations;#chi^{2}", maxIter, 0.5, maxIter + 0.5, 1000, 0, 10 * nTruthBins);
+  TH1D avgChi2("m_avg_chi2_modelData_trueData_iter_chi2", "Average #chi^{2} of statistical universes;Iterations;#chi^{2}", maxIter, 0.5, maxIter + 0.5),
+       cvChi2("m_cv_chi2_modelData_trueData_iter_chi2", "#chi^{2} of warped data;Iterations;#chi^{2}", maxIter, 0.5, maxIter + 0.5);
+
+  auto unfoldedDir = outFile->mkdir("Unfolded_Data"),
+       chi2Dir = outFile->mkdir("Chi2_Iteration_Dists");
+  for(size_t whichIter = 0; whichIter < iterations.size(); ++whichIter)
+  {
+    const int nIter = iterations[whichIter];
+
+    //Covariance of unfolded results between statistical universes
+    std::vector<double> mean(nTruthBins + 2, 0);
+    for(const auto& univ: unfolded)
+    {
+      for(int whichBin = 1; whichBin <= nTruthBins; ++whichBin) mean[whichBin] += univ[whichIter][whichBin] / nUniverses;
+    }
+
+    TMatrixD cov(nTruthBins, nTruthBins);
+    for(const auto& univ: unfolded)
+    {
+      const auto& result = univ[whichIter];
+      for(int row = 0; row < nTruthBins; ++row)
+      {
+        for(int col = 0; col < nTruthBins; ++col) cov(row, col) += (result[row + 1] - mean[row + 1]) * (result[col + 1] - mean[col + 1]) / (nUniverses - 1);
+      }
+    }
+
+    //Bins with no events make cov singular.  The SVD inverse just ignores them.
+    TDecompSVD svd(cov);
+    bool inverted = false;
+    const TMatrixD invCov = svd.Invert(inverted);
+    if(!inverted) std::cerr << "Warning: covariance matrix after " << nIter << " iterations couldn't be inverted.  Chi2s will be 0.\n";
+
+    TH1D chi2Dist(("h_chi2_modelData_trueData_iter_" + std::to_string(nIter)).c_str(), ("#chi^{2} after " + std::to_string(nIter) + " iterations;#chi^{2};Universes").c_str(), 1000, 0, 10 * nTruthBins);
+    double sumChi2 = 0;
+    for(const auto& univ: unfolded)
+    {
+      const double chi2 = inverted?Chi2(univ[whichIter], truthContents, invCov):0;
+      chi2Dist.Fill(chi2);
+      chi2VsIter.Fill(nIter, chi2);
+      sumChi2 += chi2;
+    }
+    avgChi2.SetBinContent(avgChi2.FindFixBin(nIter), sumChi2 / nUniverses);
+    cvChi2.SetBinContent(cvChi2.FindFixBin(nIter), inverted?Chi2(cv[whichIter], truthContents, invCov):0);
+
+    chi2Dir->cd();
+    chi2Dist.Write();
+
+    //The warped data unfolded with the statistical uncertainty from the universes
+    TH1D unfoldedData(*dataTruth);
+    unfoldedData.SetName(("h_data_unfolded_iter_" + std::to_string(nIter)).c_str());
+    unfoldedData.Reset();
+    for(int whichBin = 0; whichBin < nTruthBins + 2; ++whichBin) unfoldedData.SetBinContent(whichBin, cv[whichIter][whichBin]);
+    for(int whichBin = 1; whichBin <= nTruthBins; ++whichBin) unfoldedData.SetBinError(whichBin, std::sqrt(cov(whichBin - 1, whichBin - 1)));
+
+    unfoldedDir->cd();
+    unfoldedData.Write();
+    cov.Write(("m_stat_cov_iter_" + std::to_string(nIter)).c_str());
+  }
+
+  chi2Dir->cd();
+  chi2VsIter.Write();
+  avgChi2.Write();
+  cvChi2.Write();
+
+  outFile->cd();
+  TParameter<int>("ndf", nTruthBins).Write();
+  TParameter<int>("nUniverses", nUniverses).Write();
+  outFile->Write();
+  delete outFile;
+
+  return 0;
+}
@@ -25,6 +25,33 @@ margin = 0.078 #Tuned by hand
 labelSize = 0.15
 lineSize = 3
 
+#Read an MnvH1D that might have been written in runEventLoop's compact format.
+#See util/CompactHist.h.  A compact histogram is a TTree with 1 entry per error band.
+def getHist(inFile, name):
+  obj = inFile.Get(name)
+  if not obj or not obj.InheritsFrom("TTree") or obj.GetTitle() != "util::CompactHist":
+    return obj
+
+  hist = ROOT.PlotUtils.MnvH1D(obj.GetUserInfo().FindObject("cv"))
+  hist.SetName(name)
+  for band in obj:
+    nUniverses = band.nUniverses
+    if band.isLateral:
+      hist.AddLatErrorBand(str(band.band), nUniverses)
+      errBand = hist.GetLatErrorBand(str(band.band))
+    else:
+      hist.AddVertErrorBand(str(band.band), nUniverses)
+      errBand = hist.GetVertErrorBand(str(band.band))
+    errBand.SetUseSpreadError(band.useSpreadError)
+
+    for whichUniv in range(nUniverses):
+      univ = errBand.GetHist(whichUniv)
+      nBins = univ.GetNcells()
+      for whichBin in range(nBins):
+        univ.SetBinContent(whichBin, band.content[whichUniv * nBins + whichBin])
+        univ.SetBinError(whichBin, band.err2[whichUniv * nBins + whichBin]**0.5)
+  return hist
+
 TH1.AddDirectory(False)
 dataFile = TFile.Open("runEventLoopData.root")
 mcFile = TFile.Open("runEventLoopMC.root")
@@ -36,13 +63,13 @@ dataPOT = dataFile.Get("POTUsed").GetVal()
 #Also keep a sum of backgrounds that has full systematics
 #information.
 mcStack = THStack()
-signalHist = mcFile.Get(var + "_selected_signal_reco")
+signalHist = getHist(mcFile, var + "_selected_signal_reco")
 signalHist.Scale(dataPOT/mcPOT)
 mcSum = signalHist.Clone()
 for key in mcFile.GetListOfKeys():
   name = str(key.GetName())
   if name.find("background") > -1 and name.find(var) > -1:
-    hist = key.ReadObj()
+    hist = getHist(mcFile, name)
     hist.Scale(dataPOT/mcPOT)
     mcStack.Add(hist.GetCVHistoWithError().Clone())
     mcSum.Add(hist)
@@ -56,9 +83,9 @@ for hist in mcStack.GetHists():
   hist.SetFillColor(mcColors[nextColor])
   nextColor = nextColor + 1
 
-dataHist = dataFile.Get(dataName)
+dataHist = getHist(dataFile, dataName)
 dataWithStatErrors = dataHist.GetCVHistoWithError().Clone()
-dataHist.AddMissingErrorBandsAndFillWithCV(mcFile.Get(var + "_selected_signal_reco"))
+dataHist.AddMissingErrorBandsAndFillWithCV(getHist(mcFile, var + "_selected_signal_reco"))
 
 #Create a TCanvas on which to draw plots and split it into 2 panels
 overall = TCanvas("Data/MC for " + var)
@@ -17,8 +17,9 @@
 #include <iostream>
 
 #include "PlotUtils/MinervaUniverse.h"
+#include "event/AnaTupleBranches.h" //Generated from event/AnaTupleBranches.schema
 
-class CVUniverse : public PlotUtils::MinervaUniverse {
+class CVUniverse : public PlotUtils::MinervaUniverse, public AnaTupleBranches<CVUniverse> {
 
   public:
   #include "PlotUtils/MuonFunctions.h" // GetMinosEfficiencyWeight
@@ -27,7 +28,7 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
   // Constructor/Destructor
   // ========================================================================
   CVUniverse(PlotUtils::ChainWrapper* chw, double nsigma = 0)
-      : PlotUtils::MinervaUniverse(chw, nsigma) {}
+      : PlotUtils::MinervaUniverse(chw, nsigma), AnaTupleBranches<CVUniverse>(GetAnaToolName()) {}
 
   virtual ~CVUniverse() {}
 
@@ -89,19 +90,19 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
   }
 
   int GetInteractionType() const {
-    return GetInt("mc_intType");
+    return Branch_mc_intType();
   }
 
   int GetTargetNucleon() const {
-    return GetInt("mc_targetNucleon");
+    return Branch_mc_targetNucleon();
   }
   
   double GetBjorkenXTrue() const {
-    return GetDouble("mc_Bjorkenx");
+    return Branch_mc_Bjorkenx();
   }
 
   double GetBjorkenYTrue() const {
-    return GetDouble("mc_Bjorkeny");
+    return Branch_mc_Bjorkeny();
   }
 
   virtual bool IsMinosMatchMuon() const {
@@ -112,19 +113,19 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
   ROOT::Math::XYZTVector GetVertex() const
   {
     ROOT::Math::XYZTVector result;
-    result.SetCoordinates(GetVec<double>("vtx").data());
+    result.SetCoordinates(Branch_vtx().data());
     return result;
   }
 
   ROOT::Math::XYZTVector GetTrueVertex() const
   {
     ROOT::Math::XYZTVector result;
-    result.SetCoordinates(GetVec<double>("mc_vtx").data());
+    result.SetCoordinates(Branch_mc_vtx().data());
     return result;
   }
 
   virtual int GetTDead() const {
-    return GetInt("phys_n_dead_discr_pair_upstream_prim_track_proj");
+    return Branch_phys_n_dead_discr_pair_upstream_prim_track_proj();
   }
   
   //TODO: If there was a spline correcting Eavail, it might not really be Eavail.
@@ -133,16 +134,16 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
   //      this function could be correcting for neutron energy which Eavail should
   //      not do.
   virtual double GetEavail() const {
-    return GetDouble("recoilE_SplineCorrected");
+    return Branch_recoilE_SplineCorrected();
   }
   
   virtual double GetQ2Reco() const{
-    return GetDouble("qsquared_recoil");
+    return Branch_qsquared_recoil();
   }
 
   //GetRecoilE is designed to match the NSF validation suite
   virtual double GetRecoilE() const {
-    return GetVecElem("recoil_summed_energy", 0);
+    return Branch_recoil_summed_energy()[0];
   }
   
   virtual double Getq3() const{
@@ -152,12 +153,12 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
     return q3mec;
   }
    
-  virtual int GetCurrent() const { return GetInt("mc_current"); }
+  virtual int GetCurrent() const { return Branch_mc_current(); }
 
-  virtual int GetTruthNuPDG() const { return GetInt("mc_incoming"); }
+  virtual int GetTruthNuPDG() const { return Branch_mc_incoming(); }
 
   virtual double GetMuonQP() const {
-    return GetDouble((GetAnaToolName() + "_minos_trk_qp").c_str());
+    return Branch_minos_trk_qp();
   }
 
   //Some functions to match CCQENuInclusive treatment of DIS weighting. Name matches same Dan area as before.
@@ -188,7 +189,11 @@ class CVUniverse : public PlotUtils::MinervaUniverse {
     return TMath::Sqrt(pow(nuclMass,2) + 2.0*(Enu-Emu)*nuclMass - Q2);
   }
 
-  virtual int GetIsMinosMatchTrack() const { return GetInt("isMinosMatchTrack"); }
+  virtual int GetIsMinosMatchTrack() const { return Branch_isMinosMatchTrack(); }
+
+  //Where AnaTupleBranches reads from
+  TChain& BranchChain() const { return *m_chw->GetChain(); }
+  Long64_t BranchEntry() const { return m_entry; }
   
   //Still needed for some systematics to compile, but shouldn't be used for reweighting anymore.
   protected:
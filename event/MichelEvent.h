@@ -11,5 +11,17 @@ struct MichelEvent {
     double m_best_UZ;
     double m_best_VZ;
     //std::vector<Michel*> m_nmichels; //nmatched michels
+
+    //The event loops reuse one MichelEvent for every universe.  Keeps m_best2D's
+    //memory so that finding a Michel doesn't allocate again.
+    void Reset()
+    {
+      m_idx = -1;
+      m_bestdist = -1;
+      m_best2D.clear();
+      m_best_XZ = -1;
+      m_best_UZ = -1;
+      m_best_VZ = -1;
+    }
 };
 #endif
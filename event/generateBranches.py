@@ -0,0 +1,134 @@
+#!/usr/bin/python
+#Turn AnaTupleBranches.schema into a header with one typed accessor per branch.
+#CVUniverse inherits from the class this makes.  Run by CMake at build time:
+#generateBranches.py <schema> <output header>
+
+import os
+import re
+import sys
+
+types = {"int": ("int", False), "double": ("double", False), "double[]": ("double", True)}
+treeTags = {"reco": "reco", "mcReco": "mcReco", "truth": "truth"}
+anaTool = "${ANATOOL}"
+
+def parse(schemaName):
+  branches = []
+  with open(schemaName) as schema:
+    for lineNumber, line in enumerate(schema, 1):
+      line = line.split("#", 1)[0].strip()
+      if not line:
+        continue
+
+      columns = line.split()
+      if len(columns) != 3 or columns[0] not in types:
+        sys.exit(schemaName + ":" + str(lineNumber) + ": expected <int|double|double[]> <branch> <trees> but got: " + line)
+
+      trees = columns[2].split(",")
+      for tree in trees:
+        if tree not in treeTags:
+          sys.exit(schemaName + ":" + str(lineNumber) + ": unknown tree " + tree + ".  Choose from " + ", ".join(sorted(treeTags)))
+
+      name = columns[1]
+      accessor = re.sub("[^A-Za-z0-9_]", "_", name.replace(anaTool + "_", "").replace(anaTool, ""))
+      branches.append({"type": columns[0], "name": name, "accessor": accessor, "trees": trees})
+
+  accessors = [branch["accessor"] for branch in branches]
+  for accessor in set(accessors):
+    if accessors.count(accessor) > 1:
+      sys.exit(schemaName + ": more than one branch would be named Branch_" + accessor)
+  return branches
+
+#C++ expression for a branch's name
+def nameExpr(branch):
+  expr = '"' + branch["name"].replace(anaTool, '" + anaTool + "') + '"'
+  if expr.startswith('"" + '):
+    expr = expr[len('"" + '):]
+  if expr.endswith(' + ""'):
+    expr = expr[:-len(' + ""')]
+  return expr
+
+def generate(branches, schemaName):
+  lines = []
+  add = lines.append
+
+  add("//File: AnaTupleBranches.h")
+  add("//Brief: Typed accessors for every AnaTuple branch in " + os.path.basename(schemaName) + ".")
+  add("//       Generated by generateBranches.py at build time.  Edit the schema instead of this file.")
+  add("")
+  add("#ifndef EVENT_ANATUPLEBRANCHES_H")
+  add("#define EVENT_ANATUPLEBRANCHES_H")
+  add("")
+  add("//Includes from this package")
+  add('#include "util/ArrayView.h"')
+  add("")
+  add("//ROOT includes")
+  add('#include "TChain.h"')
+  add("")
+  add("//c++ includes")
+  add("#include <string>")
+  add("#include <vector>")
+  add("")
+  add("//Each branch's TLeaf is found once per file instead of by name on every call.")
+  add("//UNIV must have public TChain& BranchChain() const and Long64_t BranchEntry() const.")
+  add("template <class UNIV>")
+  add("class AnaTupleBranches")
+  add("{")
+  add("  public:")
+  add("    //Which trees a branch has to be in")
+  add("    enum Tree { reco = 1, mcReco = 2, truth = 4 };")
+  add("")
+  add("    //anaTool replaces ${ANATOOL} in branch names")
+  add("    explicit AnaTupleBranches(const std::string& anaTool):")
+  add(",\n".join("      m_" + branch["accessor"] + "(" + nameExpr(branch) + ")" for branch in branches))
+  add("    {")
+  add("    }")
+  add("")
+  add("    //Every branch that has to be in one of trees but isn't in chain")
+  add("    static std::vector<std::string> MissingBranches(TChain& chain, const std::string& anaTool, const int trees)")
+  add("    {")
+  add("      std::vector<std::string> missing;")
+  add("      const auto check = [&chain, &missing, trees](const std::string& name, const int required)")
+  add("                         {")
+  add("                           if((required & trees) && !chain.GetBranch(name.c_str())) missing.push_back(name);")
+  add("                         };")
+  for branch in branches:
+    add("      check(" + nameExpr(branch) + ", " + " | ".join(branch["trees"]) + ");")
+  if not any(anaTool in branch["name"] for branch in branches):
+    add("      (void)anaTool;")
+  add("      return missing;")
+  add("    }")
+  add("")
+  add("  protected:")
+  for branch in branches:
+    cppType, isArray = types[branch["type"]]
+    if isArray:
+      add("    util::ArrayView<" + cppType + "> Branch_" + branch["accessor"] + "() const { return m_" + branch["accessor"] + ".template Get<" + cppType + ">(Chain(), Entry()); }")
+    else:
+      add("    " + cppType + " Branch_" + branch["accessor"] + "() const { return static_cast<" + cppType + ">(m_" + branch["accessor"] + ".GetValue(Chain(), Entry())); }")
+  add("")
+  add("  private:")
+  add("    mutable util::LeafHandle " + ", ".join("m_" + branch["accessor"] for branch in branches) + ";")
+  add("")
+  add("    TChain& Chain() const { return static_cast<const UNIV*>(this)->BranchChain(); }")
+  add("    Long64_t Entry() const { return static_cast<const UNIV*>(this)->BranchEntry(); }")
+  add("};")
+  add("")
+  add("#endif //EVENT_ANATUPLEBRANCHES_H")
+  return "\n".join(lines) + "\n"
+
+if __name__ == "__main__":
+  if len(sys.argv) != 3:
+    sys.exit("USAGE: generateBranches.py <schema> <output header>")
+
+  header = generate(parse(sys.argv[1]), sys.argv[1])
+  outDir = os.path.dirname(sys.argv[2])
+  if outDir and not os.path.isdir(outDir):
+    os.makedirs(outDir)
+
+  #Don't touch the header if nothing changed so that nothing has to recompile
+  if os.path.exists(sys.argv[2]):
+    with open(sys.argv[2]) as old:
+      if old.read() == header:
+        sys.exit(0)
+  with open(sys.argv[2], "w") as out:
+    out.write(header)
@@ -22,7 +22,57 @@
 "MPARAMFILESROOT, and MPARAMFILES must be set according to the setup scripts in\n"\
 "those packages for systematics and flux reweighters to function.\n"\
 "If MNV101_SKIP_SYST is defined at all, output histograms will have no error bands.\n"\
-"This is useful for debugging the CV and running warping studies.\n\n"\
+"This is useful for debugging the CV and running warping studies.\n"\
+"If MNV101_EVENT_STORE is set to a file name, every selected entry's Variable\n"\
+"values and weights in each universe are also saved there.  Run\n"\
+"HistogramSelectedEvents on that file to remake the histograms with new binning\n"\
+"without rerunning this program.\n"\
+"If MNV101_FINE_BINS is set to a number of subdivisions, each Variable is also\n"\
+"filled with a uniform binning that all of its bin edges line up with in a\n"\
+"directory named \"fine\".  ExtractCrossSection can rebin those histograms to\n"\
+"any binning on that grid.  Each fine migration matrix takes 8 bytes per bin\n"\
+"squared in every MC universe, so the fine binning is refused if all of them\n"\
+"together would take more than 4 GB.\n"\
+"If MNV101_COMPACT_OUTPUT is set, each histogram is written as one dense array\n"\
+"of universes per error band instead of one histogram per universe.  Set it to\n"\
+"zlib, lzma, lz4, or zstd with an optional :<level> to pick a compression\n"\
+"algorithm too.  ExtractCrossSection reads either format.\n"\
+"Both files have a TTree named Manifest that lists each Variable's ingredients.\n"\
+"MNV101_VARIATIONS fills variations on the nominal cuts in the same pass over\n"\
+"each tree.  Set it to <name>:<parameter>=<value>,...;<name>:... where each\n"\
+"parameter is one of minZ, maxZ, apothem (mm), maxMuonAngle (degrees), or\n"\
+"minPzMu (MeV/c).  Each variation writes its own pair of output files with\n"\
+"_<name> added before .root.\n"\
+"MNV101_SIDEBANDS fills sidebands in the same pass as the signal region.  Set it\n"\
+"to <name>:<cut>+<cut>...;<name>:... where each sideband is the events that fail\n"\
+"every listed cut and pass all the others.  Cuts are zRange, apothem, muonAngle,\n"\
+"MINOSMatch, deadtime, and isNeutrino.  Sideband histograms go in\n"\
+"sidebands/<name> in both files.  ExtractCrossSection -s <name> uses one to\n"\
+"normalize the backgrounds.\n"\
+"Independent stages like the data loop and the MC reco loop run at the same\n"\
+"time.  MNV101_STAGE_THREADS sets how many stages can run at once.  It defaults\n"\
+"to the number of cores on this machine.\n"\
+"If MNV101_FLUX_CACHE is set to a directory, flux integrals are saved there and\n"\
+"reused by later runs with the same playlist, flux settings, binning, and flux\n"\
+"files.  Jobs can share one cache directory.\n"\
+"MNV101_PREFETCH reads files into the page cache on several threads while the\n"\
+"flux reweighter loads.  Set it to ;-separated glob patterns relative to\n"\
+"MPARAMFILESROOT, like the flux and reweighting tables this job will use.  Every\n"\
+"job on a node shares the cached files.\n"\
+"If MNV101_RETRIES is set to <n>[:<seconds>], every input file is opened and\n"\
+"read before the event loops start.  Files that fail are retried n times with\n"\
+"waits that start at seconds (default 10) and double each time.  Files that\n"\
+"still can't be read are skipped, POT only counts the files that were used, and\n"\
+"both output files list the skipped files in a TList named SkippedFiles.\n"\
+"Each event loop also retries moving to the next entry the same way, which is\n"\
+"when a new file is opened.\n"\
+"If MNV101_PERF_COUNTERS is set, each event loop counts CPU cycles,\n"\
+"instructions, last level cache misses, and branch misses in SetEntry(), cuts,\n"\
+"weights, and fills for each error band.  Each loop writes its counts to a\n"\
+"_perf_<loop>.csv file named after its output file.  The kernel has to allow\n"\
+"perf_event_open().  See /proc/sys/kernel/perf_event_paranoid.\n"\
+"Input files must have every branch in event/AnaTupleBranches.schema.  This\n"\
+"program returns 2 before any event loop starts if one is missing.\n\n"\
 "*** Return Codes ***\n"\
 "0 indicates success.  All histograms are valid only in this case.  Any other\n"\
 "return code indicates that histograms should not be used.  Error messages\n"\
@@ -54,6 +104,16 @@ enum ErrorCodes
 #include "util/Variable2D.h"
 #include "util/GetFluxIntegral.h"
 #include "util/GetPlaylist.h"
+#include "util/EventStore.h"
+#include "util/Rebin.h"
+#include "util/CompactHist.h"
+#include "util/TaskGraph.h"
+#include "util/Prefetch.h"
+#include "util/Preflight.h"
+#include "util/PerfCounters.h"
+#include "util/AnalysisConfig.h"
+#include "util/UniverseTable.h"
+#include "util/EventSelectionEntry.h"
 #include "cuts/SignalDefinition.h"
 #include "cuts/q3RecoCut.h"
 #include "studies/Study.h"
@@ -71,6 +131,7 @@ enum ErrorCodes
 #include "PlotUtils/Cutter.h"
 #include "PlotUtils/Model.h"
 #include "PlotUtils/FluxAndCVReweighter.h"
+#include "PlotUtils/FluxReweighter.h"
 #include "PlotUtils/GENIEReweighter.h"
 #include "PlotUtils/LowRecoil2p2hReweighter.h"
 #include "PlotUtils/RPAReweighter.h"
@@ -80,175 +141,438 @@ enum ErrorCodes
 
 //ROOT includes
 #include "TParameter.h"
+#include "TROOT.h" //ROOT::EnableThreadSafety()
 
 //c++ includes
 #include <iostream>
 #include <cstdlib> //getenv()
+#include <memory> //std::unique_ptr
+#include <sstream> //std::stringstream
+#include <stdexcept> //std::invalid_argument
+#include <bitset>
+#include <set>
+#include <thread> //std::thread::hardware_concurrency()
+
+//==============================================================================
+// Analysis Configurations
+//==============================================================================
+//Parse MNV101_VARIATIONS which looks like <name>:<parameter>=<value>,...;<name>:...
+//Each variation starts from nominal.  Throws std::invalid_argument for anything it doesn't understand.
+std::vector<AnalysisConfig> ParseVariations(const std::string& variations, const AnalysisConfig& nominal)
+{
+  std::vector<AnalysisConfig> configs;
+  std::stringstream allVariations(variations);
+  for(std::string variation; std::getline(allVariations, variation, ';');)
+  {
+    if(variation.empty()) continue;
+    const size_t colon = variation.find(":");
+    if(colon == 0 || colon == std::string::npos) throw std::invalid_argument("Expected <name>:<parameter>=<value>,... but got " + variation);
+
+    AnalysisConfig config;
+    config.name = util::SafeROOTName(variation.substr(0, colon));
+    config.minZ = nominal.minZ;
+    config.maxZ = nominal.maxZ;
+    config.apothem = nominal.apothem;
+    config.maxMuonAngle = nominal.maxMuonAngle;
+    config.minPzMu = nominal.minPzMu;
+    config.sidebands = nominal.sidebands;
+
+    const std::map<std::string, double AnalysisConfig::*> parameters = {{"minZ", &AnalysisConfig::minZ},
+                                                                        {"maxZ", &AnalysisConfig::maxZ},
+                                                                        {"apothem", &AnalysisConfig::apothem},
+                                                                        {"maxMuonAngle", &AnalysisConfig::maxMuonAngle},
+                                                                        {"minPzMu", &AnalysisConfig::minPzMu}};
+    std::stringstream settings(variation.substr(colon + 1));
+    for(std::string setting; std::getline(settings, setting, ',');)
+    {
+      const size_t equals = setting.find("=");
+      const auto found = parameters.find(setting.substr(0, equals));
+      if(equals == std::string::npos || found == parameters.end()) throw std::invalid_argument("Unknown setting " + setting + " for variation " + config.name);
+      config.*(found->second) = std::stod(setting.substr(equals + 1));
+    }
+
+    configs.push_back(std::move(config));
+  }
+
+  return configs;
+}
+
+//Parse MNV101_SIDEBANDS which looks like <name>:<cut>+<cut>...;<name>:...
+//Throws std::invalid_argument if a sideband doesn't have a name or any cuts.
+std::vector<AnalysisConfig::Sideband> ParseSidebands(const std::string& sidebands)
+{
+  std::vector<AnalysisConfig::Sideband> parsed;
+  std::stringstream allSidebands(sidebands);
+  for(std::string sideband; std::getline(allSidebands, sideband, ';');)
+  {
+    if(sideband.empty()) continue;
+    const size_t colon = sideband.find(":");
+    if(colon == 0 || colon == std::string::npos || colon + 1 == sideband.size()) throw std::invalid_argument("Expected <name>:<cut>+<cut>... but got " + sideband);
+
+    AnalysisConfig::Sideband region;
+    region.name = util::SafeROOTName(sideband.substr(0, colon));
+    std::stringstream cutNames(sideband.substr(colon + 1));
+    for(std::string cutName; std::getline(cutNames, cutName, '+');) region.cutNames.push_back(cutName);
+    parsed.push_back(region);
+  }
+
+  return parsed;
+}
 
 //==============================================================================
 // Loop and Fill
 //==============================================================================
+//Each loop reuses the same MichelEvent and looks up everything it needs per
+//band before the first entry so that nothing allocates once the loop is going.
 void LoopAndFillEventSelection(
     PlotUtils::ChainWrapper* chain,
     std::map<std::string, std::vector<CVUniverse*> > error_bands,
-    std::vector<Variable*> vars,
-    std::vector<Variable2D*> vars2D,
-    std::vector<Study*> studies,
-    PlotUtils::Cutter<CVUniverse, MichelEvent>& michelcuts,
-    PlotUtils::Model<CVUniverse, MichelEvent>& model)
+    std::vector<AnalysisConfig*> configs,
+    PlotUtils::Model<CVUniverse, MichelEvent>& model,
+    util::EventStore* store,
+    const util::RetryPolicy& retry)
 {
   assert(!error_bands["cv"].empty() && "\"cv\" error band is empty!  Can't set Model weight.");
   auto& cvUniv = error_bands["cv"].front();
 
+  //Optionally count cycles and cache misses in each stage of this loop
+  std::unique_ptr<util::PerfCounters> perf(util::PerfCounters::FromEnv());
+  using perfScope = util::PerfCounters::Scope;
+  util::PerfCounters::Row* cvPerf = perf?&perf->GetRow("cv"):nullptr;
+
+  EventSelectionEntry entryFiller(error_bands, configs, model, store, perf.get());
+
   std::cout << "Starting MC reco loop...\n";
   const int nEntries = chain->GetEntries();
   for (int i=0; i<nEntries; ++i)
   {
     if(i%1000==0) std::cout << i << " / " << nEntries << "\r" <<std::flush;
 
-    MichelEvent cvEvent;
-    cvUniv->SetEntry(i);
-    model.SetEntry(*cvUniv, cvEvent);
-    const double cvWeight = model.GetWeight(*cvUniv, cvEvent);
-
-    //=========================================
-    // Systematics loop(s)
-    //=========================================
-    for (auto band : error_bands)
     {
-      std::vector<CVUniverse*> error_band_universes = band.second;
-      for (auto universe : error_band_universes)
-      {
-        MichelEvent myevent; // make sure your event is inside the error band loop. 
-    
-        // Tell the Event which entry in the TChain it's looking at
-        universe->SetEntry(i);
-         
-        // This is where you would Access/create a Michel
-
-        //weight is ignored in isMCSelected() for all but the CV Universe.
-        if (!michelcuts.isMCSelected(*universe, myevent, cvWeight).all()) continue; //all is another function that will later help me with sidebands
-        const double weight = model.GetWeight(*universe, myevent); //Only calculate the per-universe weight for events that will actually use it.
-        for(auto& var: vars) var->selectedMCReco->FillUniverse(universe, var->GetRecoValue(*universe), weight); //"Fake data" for closure
-
-        const bool isSignal = michelcuts.isSignal(*universe, weight);
-
-        if(isSignal)
-        {
-          for(auto& study: studies) study->SelectedSignal(*universe, myevent, weight);
-
-          for(auto& var: vars)
-          {
-            //Cross section components
-            var->efficiencyNumerator->FillUniverse(universe, var->GetTrueValue(*universe), weight);
-            var->migration->FillUniverse(universe, var->GetRecoValue(*universe), var->GetTrueValue(*universe), weight);
-            var->selectedSignalReco->FillUniverse(universe, var->GetRecoValue(*universe), weight); //Efficiency numerator in reco variables.  Useful for warping studies.
-          }
-
-          for(auto& var: vars2D)
-          {
-            var->efficiencyNumerator->FillUniverse(universe, var->GetTrueValueX(*universe), var->GetTrueValueY(*universe), weight);
-          }
-        }
-        else
-        {
-          int bkgd_ID = -1;
-          if (universe->GetCurrent()==2)bkgd_ID=0;
-          else bkgd_ID=1;
-
-          for(auto& var: vars) (*var->m_backgroundHists)[bkgd_ID].FillUniverse(universe, var->GetRecoValue(*universe), weight);
-          for(auto& var: vars2D) (*var->m_backgroundHists)[bkgd_ID].FillUniverse(universe, var->GetRecoValueX(*universe), var->GetRecoValueY(*universe), weight);
-        }
-      } // End band's universe loop
-    } // End Band loop
+      perfScope scope(perf.get(), cvPerf, util::PerfCounters::setEntry);
+      util::Retry<ROOT::exception>([&]()
+                                   {
+                                     chain->GetChain()->LoadTree(i);
+                                     cvUniv->SetEntry(i);
+                                   }, retry, i);
+    }
+    entryFiller.Fill(i);
   } //End entries loop
   std::cout << "Finished MC reco loop.\n";
+
+  if(perf && !perf->Write(util::PerfCounters::FileName(MC_OUT_FILE_NAME, "MCReco"))) std::cerr << "Failed to write performance counters for the MC reco loop.\n";
 }
 
 void LoopAndFillData( PlotUtils::ChainWrapper* data,
 			        std::vector<CVUniverse*> data_band,
-				std::vector<Variable*> vars,
-                                std::vector<Variable2D*> vars2D,
-                                std::vector<Study*> studies,
-				PlotUtils::Cutter<CVUniverse, MichelEvent>& michelcuts)
+                                std::vector<AnalysisConfig*> configs,
+                                util::EventStore* store,
+                                const util::RetryPolicy& retry)
 
 {
+  std::vector<std::vector<Variable*>> loopVars;
+  for(const auto config: configs) loopVars.push_back(config->LoopVars());
+
+  std::unique_ptr<util::PerfCounters> perf(util::PerfCounters::FromEnv());
+  using perfScope = util::PerfCounters::Scope;
+  util::PerfCounters::Row* dataPerf = perf?&perf->GetRow("data"):nullptr;
+
+  MichelEvent myevent;
+
   std::cout << "Starting data loop...\n";
   const int nEntries = data->GetEntries();
-  for (int i=0; i<data->GetEntries(); ++i) {
-    for (auto universe : data_band) {
-      universe->SetEntry(i);
+  for (int i=0; i<nEntries; ++i) {
+    if(store) store->BeginEntry(i);
+    {
+      perfScope scope(perf.get(), dataPerf, util::PerfCounters::setEntry);
+      util::Retry<ROOT::exception>([&]() { data->GetChain()->LoadTree(i); }, retry, i);
+    }
+    for (const auto universe : data_band) {
+      {
+        perfScope scope(perf.get(), dataPerf, util::PerfCounters::setEntry);
+        universe->SetEntry(i);
+      }
       if(i%1000==0) std::cout << i << " / " << nEntries << "\r" << std::flush;
-      MichelEvent myevent; 
-      if (!michelcuts.isDataSelected(*universe, myevent).all()) continue;
+      for(size_t whichConfig = 0; whichConfig < configs.size(); ++whichConfig)
+      {
+        const auto& config = *configs[whichConfig];
+        myevent.Reset();
+        std::bitset<64> selected;
+        {
+          perfScope scope(perf.get(), dataPerf, util::PerfCounters::cuts);
+          selected = config.dataCuts->isDataSelected(*universe, myevent);
+        }
+        perfScope fillScope(perf.get(), dataPerf, util::PerfCounters::fill);
+        const int whichSideband = config.WhichSideband(selected);
+        if(whichSideband >= 0)
+        {
+          for(auto& var: config.vars) var->m_sidebands[whichSideband].data->FillUniverse(universe, var->GetRecoValue(*universe, myevent.m_idx), 1);
+          continue;
+        }
+        if (!selected.all()) continue;
 
-      for(auto& study: studies) study->Selected(*universe, myevent, 1); 
+        if(store && whichConfig == 0) store->FillData(*universe, myevent.m_idx);
+        for(auto& study: config.dataStudies) study->Selected(*universe, myevent, 1); 
 
-      for(auto& var: vars)
-      {
-        var->dataHist->FillUniverse(universe, var->GetRecoValue(*universe, myevent.m_idx), 1);
-      }
+        for(auto& var: loopVars[whichConfig])
+        {
+          var->dataHist->FillUniverse(universe, var->GetRecoValue(*universe, myevent.m_idx), 1);
+        }
 
-      for(auto& var: vars2D)
-      {
-        var->dataHist->FillUniverse(universe, var->GetRecoValueX(*universe), var->GetRecoValueY(*universe), 1);
+        for(auto& var: config.vars2D)
+        {
+          var->dataHist->FillUniverse(universe, var->GetRecoValueX(*universe), var->GetRecoValueY(*universe), 1);
+        }
       }
     }
+    if(store) store->EndEntry();
   }
   std::cout << "Finished data loop.\n";
+
+  if(perf && !perf->Write(util::PerfCounters::FileName(DATA_OUT_FILE_NAME, "data"))) std::cerr << "Failed to write performance counters for the data loop.\n";
 }
 
 void LoopAndFillEffDenom( PlotUtils::ChainWrapper* truth,
     				std::map<std::string, std::vector<CVUniverse*> > truth_bands,
-    				std::vector<Variable*> vars,
-                                std::vector<Variable2D*> vars2D,
-    				PlotUtils::Cutter<CVUniverse, MichelEvent>& michelcuts,
-                                PlotUtils::Model<CVUniverse, MichelEvent>& model)
+                                std::vector<AnalysisConfig*> configs,
+                                PlotUtils::Model<CVUniverse, MichelEvent>& model,
+                                util::EventStore* store,
+                                const util::RetryPolicy& retry)
 {
   assert(!truth_bands["cv"].empty() && "\"cv\" error band is empty!  Could not set Model entry.");
   auto& cvUniv = truth_bands["cv"].front();
 
+  std::vector<std::vector<Variable*>> loopVars;
+  for(const auto config: configs) loopVars.push_back(config->LoopVars());
+
+  std::unique_ptr<util::PerfCounters> perf(util::PerfCounters::FromEnv());
+  using perfScope = util::PerfCounters::Scope;
+  util::PerfCounters::Row* cvPerf = perf?&perf->GetRow("cv"):nullptr;
+
+  const UniverseTable table(truth_bands, {}, perf.get());
+  MichelEvent cvEvent, myevent;
+
   std::cout << "Starting efficiency denominator loop...\n";
   const int nEntries = truth->GetEntries();
   for (int i=0; i<nEntries; ++i)
   {
     if(i%1000==0) std::cout << i << " / " << nEntries << "\r" << std::flush;
 
-    MichelEvent cvEvent;
-    cvUniv->SetEntry(i);
-    model.SetEntry(*cvUniv, cvEvent);
-    const double cvWeight = model.GetWeight(*cvUniv, cvEvent);
+    cvEvent.Reset();
+    double cvWeight = 0;
+    {
+      perfScope scope(perf.get(), cvPerf, util::PerfCounters::setEntry);
+      util::Retry<ROOT::exception>([&]()
+                                   {
+                                     truth->GetChain()->LoadTree(i);
+                                     cvUniv->SetEntry(i);
+                                   }, retry, i);
+    }
+    {
+      perfScope scope(perf.get(), cvPerf, util::PerfCounters::weight);
+      model.SetEntry(*cvUniv, cvEvent);
+      cvWeight = model.GetWeight(*cvUniv, cvEvent);
+    }
+    if(store) store->BeginEntry(i);
 
     //=========================================
     // Systematics loop(s)
     //=========================================
-    for (auto band : truth_bands)
+    for (const auto& slot: table.universes)
     {
-      std::vector<CVUniverse*> truth_band_universes = band.second;
-      for (auto universe : truth_band_universes)
-      {
-        MichelEvent myevent; //Only used to keep the Model happy
+      CVUniverse* universe = slot.universe;
+      util::PerfCounters::Row* bandPerf = slot.band->perf;
+      myevent.Reset(); //Only used to keep the Model happy
 
-        // Tell the Event which entry in the TChain it's looking at
+      // Tell the Event which entry in the TChain it's looking at
+      {
+        perfScope scope(perf.get(), bandPerf, util::PerfCounters::setEntry);
         universe->SetEntry(i);
+      }
 
-        if (!michelcuts.isEfficiencyDenom(*universe, cvWeight)) continue; //Weight is ignored for isEfficiencyDenom() in all but the CV universe 
-        const double weight = model.GetWeight(*universe, myevent); //Only calculate the weight for events that will use it
+      //Shared by every configuration like in LoopAndFillEventSelection()
+      double weight = 0;
+      bool haveWeight = false;
+      for(size_t whichConfig = 0; whichConfig < configs.size(); ++whichConfig)
+      {
+        bool isEfficiencyDenom = false;
+        {
+          perfScope scope(perf.get(), bandPerf, util::PerfCounters::cuts);
+          isEfficiencyDenom = configs[whichConfig]->cuts->isEfficiencyDenom(*universe, cvWeight); //Weight is ignored for isEfficiencyDenom() in all but the CV universe 
+        }
+        if (!isEfficiencyDenom) continue;
+        if(!haveWeight) //Only calculate the weight for events that will use it
+        {
+          perfScope scope(perf.get(), bandPerf, util::PerfCounters::weight);
+          weight = model.GetWeight(*universe, myevent);
+        }
+        haveWeight = true;
+        perfScope fillScope(perf.get(), bandPerf, util::PerfCounters::fill);
+        if(whichConfig == 0)
+        {
+          if(store) store->FillEffDenom(*universe, weight);
+        }
 
         //Fill efficiency denominator now: 
-        for(auto var: vars)
+        for(auto var: loopVars[whichConfig])
         {
           var->efficiencyDenominator->FillUniverse(universe, var->GetTrueValue(*universe), weight);
         }
 
-        for(auto var: vars2D)
+        for(auto var: configs[whichConfig]->vars2D)
         {
           var->efficiencyDenominator->FillUniverse(universe, var->GetTrueValueX(*universe), var->GetTrueValueY(*universe), weight);
         }
       }
     }
+    if(store) store->EndEntry();
   }
   std::cout << "Finished efficiency denominator loop.\n";
+
+  if(perf && !perf->Write(util::PerfCounters::FileName(MC_OUT_FILE_NAME, "efficiencyDenominator"))) std::cerr << "Failed to write performance counters for the efficiency denominator loop.\n";
+}
+
+//==============================================================================
+// Write Results
+//==============================================================================
+//Table of contents so that ExtractCrossSection doesn't have to search for ingredients
+std::vector<util::Manifest::Entry> MCManifest(const std::vector<Variable*>& manifestVars)
+{
+  std::vector<util::Manifest::Entry> entries;
+  for(auto& var: manifestVars) entries.push_back(var->GetMCManifestEntry());
+  return entries;
+}
+
+std::vector<util::Manifest::Entry> DataManifest(const std::vector<Variable*>& manifestVars)
+{
+  std::vector<util::Manifest::Entry> entries;
+  for(auto& var: manifestVars) entries.push_back(var->GetDataManifestEntry());
+  return entries;
+}
+
+//Write one AnalysisConfig's MC histograms along with everything ExtractCrossSection
+//needs to go with them.  fluxIntegrals has an integrated flux for each of config's
+//LoopVars().  skipped lists the MC files that couldn't be read.  Throws std::runtime_error
+//if the output file couldn't be opened.
+void WriteMCResults(const AnalysisConfig& config, const std::map<const Variable*, std::unique_ptr<PlotUtils::MnvH1D>>& fluxIntegrals, const double mcPOTUsed,
+                    const std::vector<std::string>& skipped)
+{
+  const std::string mcFileName = config.FileName(MC_OUT_FILE_NAME);
+  std::unique_ptr<TFile> mcOutDir(TFile::Open(mcFileName.c_str(), "RECREATE"));
+  if(!mcOutDir) throw std::runtime_error("Failed to open a file named " + mcFileName + " in the current directory for writing histograms.");
+  util::SetCompactCompression(*mcOutDir);
+  mcOutDir->cd();
+
+  for(auto& study: config.studies) study->SaveOrDraw(*mcOutDir);
+  for(auto& var: config.vars) var->WriteMC(*mcOutDir);
+  for(auto& var: config.vars2D) var->WriteMC(*mcOutDir);
+
+  //Protons On Target
+  auto mcPOT = new TParameter<double>("POTUsed", mcPOTUsed);
+  mcPOT->Write();
+  if(!skipped.empty()) util::WriteSkippedFiles(skipped, *mcOutDir);
+
+  const double nFiducialNucleons = config.FiducialNucleons();
+
+  for(const auto& var: config.vars)
+  {
+    //Flux integral only if systematics are being done (temporary solution)
+    util::WriteHist(*fluxIntegrals.at(var), *mcOutDir, var->GetName() + "_reweightedflux_integrated");
+    //Always use MC number of nucleons for cross section
+    auto nNucleons = new TParameter<double>((var->GetName() + "_fiducial_nucleons").c_str(), nFiducialNucleons);
+    nNucleons->Write();
+  }
+
+  util::Manifest::Write(*mcOutDir, MCManifest(config.vars), mcPOTUsed);
+
+  //Same ingredients with fine binning
+  if(!config.fineVars.empty())
+  {
+    auto fineDir = mcOutDir->mkdir("fine");
+    for(auto& var: config.fineVars) var->WriteMC(*fineDir);
+
+    fineDir->cd();
+    for(const auto& var: config.fineVars)
+    {
+      util::WriteHist(*fluxIntegrals.at(var), *fineDir, var->GetName() + "_reweightedflux_integrated");
+      auto nNucleons = new TParameter<double>((var->GetName() + "_fiducial_nucleons").c_str(), nFiducialNucleons);
+      nNucleons->Write();
+    }
+    util::Manifest::Write(*fineDir, MCManifest(config.fineVars), mcPOTUsed);
+  }
+
+  //Each sideband gets its own directory with its own Manifest
+  if(!config.sidebands.empty())
+  {
+    auto sidebandsDir = mcOutDir->mkdir("sidebands");
+    for(size_t whichSideband = 0; whichSideband < config.sidebands.size(); ++whichSideband)
+    {
+      auto sidebandDir = sidebandsDir->mkdir(config.sidebands[whichSideband].name.c_str());
+      std::vector<util::Manifest::Entry> entries;
+      for(auto& var: config.vars)
+      {
+        var->WriteSidebandMC(*sidebandDir, whichSideband);
+        entries.push_back(var->GetSidebandMCManifestEntry(whichSideband));
+      }
+      util::Manifest::Write(*sidebandDir, entries, mcPOTUsed);
+    }
+    mcOutDir->cd();
+  }
+}
+
+//Variable2D's data histograms go in the MC file.  Adds them to the file
+//WriteMCResults() wrote once the data loop is done.  Throws std::runtime_error
+//if that file couldn't be opened.
+void WriteMC2DData(const AnalysisConfig& config)
+{
+  const std::string mcFileName = config.FileName(MC_OUT_FILE_NAME);
+  std::unique_ptr<TFile> mcOutDir(TFile::Open(mcFileName.c_str(), "UPDATE"));
+  if(!mcOutDir) throw std::runtime_error("Failed to open a file named " + mcFileName + " in the current directory for writing 2D data histograms.");
+  util::SetCompactCompression(*mcOutDir);
+
+  for(auto& var: config.vars2D) var->WriteData(*mcOutDir);
+}
+
+//Same for data.  Throws std::runtime_error if the output file couldn't be opened.
+void WriteDataResults(const AnalysisConfig& config, const double dataPOTUsed, const std::vector<std::string>& skipped)
+{
+  const std::string dataFileName = config.FileName(DATA_OUT_FILE_NAME);
+  std::unique_ptr<TFile> dataOutDir(TFile::Open(dataFileName.c_str(), "RECREATE"));
+  if(!dataOutDir) throw std::runtime_error("Failed to open a file named " + dataFileName + " in the current directory for writing histograms.");
+  util::SetCompactCompression(*dataOutDir);
+  dataOutDir->cd();
+
+  for(auto& var: config.vars) var->WriteData(*dataOutDir);
+  util::Manifest::Write(*dataOutDir, DataManifest(config.vars), dataPOTUsed);
+  if(!config.fineVars.empty())
+  {
+    auto fineDir = dataOutDir->mkdir("fine");
+    for(auto& var: config.fineVars) var->WriteData(*fineDir);
+    util::Manifest::Write(*fineDir, DataManifest(config.fineVars), dataPOTUsed);
+    dataOutDir->cd();
+  }
+
+  if(!config.sidebands.empty())
+  {
+    auto sidebandsDir = dataOutDir->mkdir("sidebands");
+    for(size_t whichSideband = 0; whichSideband < config.sidebands.size(); ++whichSideband)
+    {
+      auto sidebandDir = sidebandsDir->mkdir(config.sidebands[whichSideband].name.c_str());
+      std::vector<util::Manifest::Entry> entries;
+      for(auto& var: config.vars)
+      {
+        var->WriteSidebandData(*sidebandDir, whichSideband);
+        entries.push_back(var->GetSidebandDataManifestEntry(whichSideband));
+      }
+      util::Manifest::Write(*sidebandDir, entries, dataPOTUsed);
+    }
+    dataOutDir->cd();
+  }
+
+  //Protons On Target
+  auto dataPOT = new TParameter<double>("POTUsed", dataPOTUsed);
+  dataPOT->Write();
+  if(!skipped.empty()) util::WriteSkippedFiles(skipped, *dataOutDir);
 }
 
 //Returns false if recoTreeName could not be inferred
@@ -332,6 +656,28 @@ int main(const int argc, const char** argv)
   const std::string mc_file_list = argv[2],
                     data_file_list = argv[1];
 
+  //Threads for independent stages and for checking input files
+  size_t nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  const char* nThreadsSpec = getenv("MNV101_STAGE_THREADS");
+  if(nThreadsSpec)
+  {
+    try
+    {
+      nThreads = std::stoul(nThreadsSpec);
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Failed to parse MNV101_STAGE_THREADS: " << e.what() << "\n" << USAGE << "\n";
+      return badCmdLine;
+    }
+  }
+  //Older ROOT versions can't read files from more than one thread
+  #ifndef NCINTEX
+  nThreads = 1;
+  #else
+  if(nThreads > 1) ROOT::EnableThreadSafety();
+  #endif
+
   //Check that necessary TTrees exist in the first file of mc_file_list and data_file_list
   std::string reco_tree_name;
   if(!inferRecoTreeNameAndCheckTreeNames(mc_file_list, data_file_list, reco_tree_name))
@@ -340,10 +686,51 @@ int main(const int argc, const char** argv)
     return badInputFile;
   }
 
+  //Optionally make sure every file can be read before spending hours on the event loops.
+  //Files that can't be read even after retrying are left out of new playlists.
+  //MacroUtil counts POT from those new playlists, so POT stays consistent with the events used.
+  std::string mcPlaylistToRead = mc_file_list, dataPlaylistToRead = data_file_list;
+  util::PreflightResult mcPreflight, dataPreflight;
+  util::RetryPolicy retry;
+  const char* retrySpec = getenv("MNV101_RETRIES");
+  if(retrySpec)
+  {
+    const std::string retries = retrySpec;
+    const size_t colon = retries.find(":");
+    try
+    {
+      retry.nRetries = std::stoi(retries.substr(0, colon));
+      if(colon != std::string::npos) retry.firstWait = std::stod(retries.substr(colon + 1));
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Failed to parse MNV101_RETRIES: " << e.what() << "\n" << USAGE << "\n";
+      return badCmdLine;
+    }
+
+    std::cout << "Checking every input file with up to " << retry.nRetries << " retries because environment variable MNV101_RETRIES is set.\n";
+    mcPreflight = util::Preflight(mc_file_list, {"Meta", "Truth", reco_tree_name}, retry.nRetries, retry.firstWait, nThreads);
+    dataPreflight = util::Preflight(data_file_list, {"Meta", reco_tree_name}, retry.nRetries, retry.firstWait, nThreads);
+
+    const auto playlistName = [](const std::string& playlist) { return "readable_" + playlist.substr(playlist.rfind("/") + 1); }; //npos + 1 is 0
+    mcPlaylistToRead = playlistName(mc_file_list);
+    dataPlaylistToRead = playlistName(data_file_list);
+    if(mcPlaylistToRead == dataPlaylistToRead) dataPlaylistToRead = "data_" + dataPlaylistToRead;
+    if(mcPreflight.readable.empty() || dataPreflight.readable.empty()
+       || !util::WritePlaylist(mcPreflight.readable, mcPlaylistToRead) || !util::WritePlaylist(dataPreflight.readable, dataPlaylistToRead))
+    {
+      std::cerr << "Either no input files could be read or I couldn't write the playlists of files that could.\n";
+      return badInputFile;
+    }
+
+    for(const auto& file: mcPreflight.skipped) std::cerr << "Skipping MC file " << file << " because it couldn't be read.\n";
+    for(const auto& file: dataPreflight.skipped) std::cerr << "Skipping data file " << file << " because it couldn't be read.\n";
+  }
+
   const bool doCCQENuValidation = (reco_tree_name == "CCQENu"); //Enables extra histograms and might influence which systematics I use.
 
   //const bool is_grid = false; //TODO: Are we going to put this back?  Gonzalo needs it iirc.
-  PlotUtils::MacroUtil options(reco_tree_name, mc_file_list, data_file_list, "minervame1A", true);
+  PlotUtils::MacroUtil options(reco_tree_name, mcPlaylistToRead, dataPlaylistToRead, "minervame1A", true);
   options.m_plist_string = util::GetPlaylist(*options.m_mc, true); //TODO: Put GetPlaylist into PlotUtils::MacroUtil
 
   // You're required to make some decisions
@@ -355,28 +742,33 @@ int main(const int argc, const char** argv)
 
   PlotUtils::MinervaUniverse::RPAMaterials(true); 
 
-  //Now that we've defined what a cross section is, decide which sample and model
-  //we're extracting a cross section for.
-  PlotUtils::Cutter<CVUniverse, MichelEvent>::reco_t sidebands, preCuts;
-  PlotUtils::Cutter<CVUniverse, MichelEvent>::truth_t signalDefinition, phaseSpace;
-
-  const double minZ = 5980, maxZ = 8422, apothem = 850; //All in mm
-  preCuts.emplace_back(new reco::ZRange<CVUniverse, MichelEvent>("Tracker", minZ, maxZ));
-  preCuts.emplace_back(new reco::Apothem<CVUniverse, MichelEvent>(apothem));
-  preCuts.emplace_back(new reco::MaxMuonAngle<CVUniverse, MichelEvent>(20.));
-  preCuts.emplace_back(new reco::HasMINOSMatch<CVUniverse, MichelEvent>());
-  preCuts.emplace_back(new reco::NoDeadtime<CVUniverse, MichelEvent>(1, "Deadtime"));
-  preCuts.emplace_back(new reco::IsNeutrino<CVUniverse, MichelEvent>());
-                                                                                                                                                   
-  signalDefinition.emplace_back(new truth::IsNeutrino<CVUniverse>());
-  signalDefinition.emplace_back(new truth::IsCC<CVUniverse>());
-                                                                                                                                                   
-  phaseSpace.emplace_back(new truth::ZRange<CVUniverse>("Tracker", minZ, maxZ));
-  phaseSpace.emplace_back(new truth::Apothem<CVUniverse>(apothem));
-  phaseSpace.emplace_back(new truth::MuonAngle<CVUniverse>(20.));
-  phaseSpace.emplace_back(new truth::PZMuMin<CVUniverse>(1500.));
-                                                                                                                                                   
-  PlotUtils::Cutter<CVUniverse, MichelEvent> mycuts(std::move(preCuts), std::move(sidebands) , std::move(signalDefinition),std::move(phaseSpace));
+  AnalysisConfig nominal;
+  std::vector<AnalysisConfig> variations;
+  try
+  {
+    //Optionally fill sidebands in the same pass as the signal region
+    const char* sidebandSpec = getenv("MNV101_SIDEBANDS");
+    if(sidebandSpec)
+    {
+      nominal.sidebands = ParseSidebands(sidebandSpec);
+      std::cout << "Filling " << nominal.sidebands.size() << " sidebands because environment variable MNV101_SIDEBANDS is set.\n";
+    }
+    nominal.MakeCuts();
+
+    //Optionally fill variations on the nominal cuts in the same pass over each tree
+    const char* variationSpec = getenv("MNV101_VARIATIONS");
+    if(variationSpec)
+    {
+      variations = ParseVariations(variationSpec, nominal);
+      for(auto& variation: variations) variation.MakeCuts();
+      std::cout << "Filling " << variations.size() << " variations because environment variable MNV101_VARIATIONS is set.\n";
+    }
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "Failed to parse MNV101_SIDEBANDS or MNV101_VARIATIONS: " << e.what() << "\n" << USAGE << "\n";
+    return badCmdLine;
+  }
 
   std::vector<std::unique_ptr<PlotUtils::Reweighter<CVUniverse, MichelEvent>>> MnvTunev1;
   MnvTunev1.emplace_back(new PlotUtils::FluxAndCVReweighter<CVUniverse, MichelEvent>());
@@ -410,6 +802,24 @@ int main(const int argc, const char** argv)
   }
   truth_bands["cv"] = {new CVUniverse(options.m_truth)};
 
+  //Every branch in event/AnaTupleBranches.schema has to be in the trees that read it.
+  //Better to find out now than after the MC loop has run for an hour.
+  {
+    const std::string anaTool = error_bands["cv"].front()->GetAnaToolName();
+    std::vector<std::pair<std::string, std::vector<std::string>>> missing = {
+      {"data", CVUniverse::MissingBranches(*options.m_data->GetChain(), anaTool, CVUniverse::reco)},
+      {"MC", CVUniverse::MissingBranches(*options.m_mc->GetChain(), anaTool, CVUniverse::reco | CVUniverse::mcReco)},
+      {"Truth", CVUniverse::MissingBranches(*options.m_truth->GetChain(), anaTool, CVUniverse::truth)}};
+
+    bool anyMissing = false;
+    for(const auto& tree: missing)
+    {
+      for(const auto& branch: tree.second) std::cerr << "The " << tree.first << " tree is missing branch " << branch << " that CVUniverse reads.\n";
+      anyMissing = anyMissing || !tree.second.empty();
+    }
+    if(anyMissing) return badInputFile;
+  }
+
   std::vector<double> dansPTBins = {0, 0.075, 0.15, 0.25, 0.325, 0.4, 0.475, 0.55, 0.7, 0.85, 1, 1.25, 1.5, 2.5, 4.5},
                       dansPzBins = {1.5, 2, 2.5, 3, 3.5, 4, 4.5, 5, 6, 7, 8, 9, 10, 15, 20, 40, 60},
                       robsEmuBins = {0,1,2,3,4,5,7,9,12,15,18,22,36,50,75,100,120},
@@ -432,6 +842,52 @@ int main(const int argc, const char** argv)
     vars2D.push_back(new Variable2D(*vars[1], *vars[0]));
   }
 
+  //Optionally fill a fine-binned copy of each Variable so that ExtractCrossSection can choose new binning
+  std::vector<Variable*> fineVars;
+  const char* fineSubdivisions = getenv("MNV101_FINE_BINS");
+  if(fineSubdivisions)
+  {
+    std::cout << "Filling fine-binned copies of each Variable because environment variable MNV101_FINE_BINS is set.\n";
+    int nSubdivisions = 0;
+    try
+    {
+      nSubdivisions = std::stoi(fineSubdivisions);
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Failed to parse MNV101_FINE_BINS: " << e.what() << "\n" << USAGE << "\n";
+      return badCmdLine;
+    }
+    if(nSubdivisions < 1)
+    {
+      std::cerr << "MNV101_FINE_BINS must be at least 1, but it is " << nSubdivisions << ".\n" << USAGE << "\n";
+      return badCmdLine;
+    }
+
+    //Every MC universe gets its own fine migration matrix with flow bins on both axes
+    size_t nMCUniverses = 0;
+    for(const auto& band: error_bands) nMCUniverses += band.second.size();
+    const double maxMigrationBytes = 4e9;
+    double migrationBytes = 0;
+
+    for(const auto var: vars)
+    {
+      const auto fineBins = util::FineBinning(var->GetBinVec(), nSubdivisions);
+      const double nCells = fineBins.size() + 1; //fineBins.size() - 1 bins plus 2 flow bins
+      migrationBytes += nCells * nCells * sizeof(double) * nMCUniverses;
+      fineVars.push_back(new Variable(var->GetName(), var->GetAxisLabel(), fineBins,
+                                      [var](const CVUniverse& univ) { return var->GetRecoValue(univ); },
+                                      [var](const CVUniverse& univ) { return var->GetTrueValue(univ); }));
+    }
+
+    if(migrationBytes > maxMigrationBytes)
+    {
+      std::cerr << "MNV101_FINE_BINS=" << nSubdivisions << " needs " << migrationBytes / 1e9 << " GB for fine migration matrices in "
+                << nMCUniverses << " MC universes, but the limit is " << maxMigrationBytes / 1e9 << " GB.  Use fewer subdivisions.\n";
+      return badCmdLine;
+    }
+  }
+
   std::vector<Study*> studies;
 
   CVUniverse* data_universe = new CVUniverse(options.m_data);
@@ -441,68 +897,160 @@ int main(const int argc, const char** argv)
   
   std::vector<Study*> data_studies;
 
-  for(auto& var: vars) var->InitializeMCHists(error_bands, truth_bands);
-  for(auto& var: vars) var->InitializeDATAHists(data_band);
-
-  for(auto& var: vars2D) var->InitializeMCHists(error_bands, truth_bands);
-  for(auto& var: vars2D) var->InitializeDATAHists(data_band);
+  nominal.vars = vars;
+  nominal.fineVars = fineVars;
+  nominal.vars2D = vars2D;
+  nominal.studies = studies;
+  nominal.dataStudies = data_studies;
 
-  // Loop entries and fill
-  try
+  //Each variation gets its own copy of the nominal Variables
+  for(auto& variation: variations)
   {
-    CVUniverse::SetTruth(false);
-    LoopAndFillEventSelection(options.m_mc, error_bands, vars, vars2D, studies, mycuts, model);
-    CVUniverse::SetTruth(true);
-    LoopAndFillEffDenom(options.m_truth, truth_bands, vars, vars2D, mycuts, model);
-    options.PrintMacroConfiguration(argv[0]);
-    std::cout << "MC cut summary:\n" << mycuts << "\n";
-    mycuts.resetStats();
-
-    CVUniverse::SetTruth(false);
-    LoopAndFillData(options.m_data, data_band, vars, vars2D, data_studies, mycuts);
-    std::cout << "Data cut summary:\n" << mycuts << "\n";
-
-    //Write MC results
-    TFile* mcOutDir = TFile::Open(MC_OUT_FILE_NAME, "RECREATE");
-    if(!mcOutDir)
+    for(const auto var: vars)
     {
-      std::cerr << "Failed to open a file named " << MC_OUT_FILE_NAME << " in the current directory for writing histograms.\n";
-      return badOutputFile;
+      variation.vars.push_back(new Variable(var->GetName(), var->GetAxisLabel(), var->GetBinVec(),
+                                            [var](const CVUniverse& univ) { return var->GetRecoValue(univ); },
+                                            [var](const CVUniverse& univ) { return var->GetTrueValue(univ); }));
     }
+  }
+
+  std::vector<AnalysisConfig*> configs = {&nominal};
+  for(auto& variation: variations) configs.push_back(&variation);
 
-    for(auto& study: studies) study->SaveOrDraw(*mcOutDir);
-    for(auto& var: vars) var->WriteMC(*mcOutDir);
-    for(auto& var: vars2D) var->Write(*mcOutDir);
+  for(const auto config: configs)
+  {
+    for(auto& var: config->LoopVars()) var->InitializeMCHists(error_bands, truth_bands);
+    for(auto& var: config->LoopVars()) var->InitializeDATAHists(data_band);
 
-    //Protons On Target
-    auto mcPOT = new TParameter<double>("POTUsed", options.m_mc_pot);
-    mcPOT->Write();
+    for(auto& var: config->vars2D) var->InitializeMCHists(error_bands, truth_bands);
+    for(auto& var: config->vars2D) var->InitializeDATAHists(data_band);
 
-    PlotUtils::TargetUtils targetInfo;
-    assert(error_bands["cv"].size() == 1 && "List of error bands must contain a universe named \"cv\" for the flux integral.");
+    for(auto& var: config->vars) var->InitializeSidebandHists(config->sidebands.size(), error_bands, data_band);
+  }
 
-    for(const auto& var: vars)
+  //Optionally save selected events so that histograms can be remade quickly later
+  std::unique_ptr<util::EventStore> eventStore;
+  const char* eventStoreName = getenv("MNV101_EVENT_STORE");
+  if(eventStoreName)
+  {
+    std::cout << "Saving selected events to " << eventStoreName << " because environment variable MNV101_EVENT_STORE is set.\n";
+    try
     {
-      //Flux integral only if systematics are being done (temporary solution)
-      util::GetFluxIntegral(*error_bands["cv"].front(), var->efficiencyNumerator->hist)->Write((var->GetName() + "_reweightedflux_integrated").c_str());
-      //Always use MC number of nucleons for cross section
-      auto nNucleons = new TParameter<double>((var->GetName() + "_fiducial_nucleons").c_str(), targetInfo.GetTrackerNNucleons(minZ, maxZ, true, apothem));
-      nNucleons->Write();
+      eventStore.reset(new util::EventStore(eventStoreName, vars, error_bands, truth_bands));
     }
-
-    //Write data results
-    TFile* dataOutDir = TFile::Open(DATA_OUT_FILE_NAME, "RECREATE");
-    if(!dataOutDir)
+    catch(const std::runtime_error& e)
     {
-      std::cerr << "Failed to open a file named " << DATA_OUT_FILE_NAME << " in the current directory for writing histograms.\n";
+      std::cerr << e.what() << "\n";
       return badOutputFile;
     }
+  }
 
-    for(auto& var: vars) var->WriteData(*dataOutDir);
+  //The flux integrals only need each Variable's binning.  Copy it before the
+  //event loops start filling the efficiency numerators.
+  std::map<const Variable*, std::unique_ptr<PlotUtils::MnvH1D>> fluxTemplates, fluxIntegrals;
+  for(const auto config: configs)
+  {
+    for(const auto var: config->LoopVars()) fluxTemplates[var].reset(static_cast<PlotUtils::MnvH1D*>(var->efficiencyNumerator->hist->Clone()));
+  }
 
-    //Protons On Target
-    auto dataPOT = new TParameter<double>("POTUsed", options.m_data_pot);
-    dataPOT->Write();
+  assert(!error_bands["cv"].empty() && "List of error bands must contain a universe named \"cv\" for the flux integral.");
+  const CVUniverse& cv = *error_bands["cv"].front();
+  const double nFiducialNucleons = nominal.FiducialNucleons();
+
+  //Stages that don't depend on each other run at the same time.  CVUniverse::SetTruth()
+  //is global, so the truth loop can't overlap either reco loop.  Neither can stages
+  //that use the Model, the EventStore, or the flux reweighter for different things.
+  //In practice, the data loop and data writes overlap loading the flux reweighter,
+  //the MC reco loop, and the flux integrals.  Everything else takes turns.
+  //PrintDurations() shows when each stage started and ended.
+  util::TaskGraph stages;
+
+  //The EventStore has one set of branch buffers, so loops that fill it take turns.
+  //Without an EventStore, it doesn't hold anything up.
+  const auto withStore = [&eventStore](std::map<std::string, std::string> resources, const std::string& state)
+                         {
+                           if(eventStore) resources["eventStore"] = state;
+                           return resources;
+                         };
+
+  //Optionally read the reweighters' tables into the page cache while the flux reweighter loads
+  const char* prefetchSpec = getenv("MNV101_PREFETCH");
+  if(prefetchSpec)
+  {
+    const char* paramFiles = getenv("MPARAMFILESROOT");
+    const auto prefetchFiles = util::ExpandFilePatterns(prefetchSpec, paramFiles?paramFiles:"");
+    std::cout << "Prefetching " << prefetchFiles.size() << " files because environment variable MNV101_PREFETCH is set.\n";
+    stages.Add("Prefetch reweighter files", [prefetchFiles, nThreads]() { util::Prefetch(prefetchFiles, nThreads); });
+  }
+
+  //The flux reweighter reads its flux files the first time it's used.  Load it
+  //once up front so that the data loop can run in the meantime.
+  const auto fluxLoad = stages.Add("Load flux reweighter", [&cv]()
+                                                           {
+                                                             PlotUtils::flux_reweighter(cv.GetPlaylist(), cv.GetAnalysisNuPDG(), cv.UseNuEConstraint(), cv.GetNFluxUniverses());
+                                                           },
+                                   {}, {{"fluxReweighter", "Load flux reweighter"}});
+
+  const auto mcLoop = stages.Add("MC reco loop", [&]()
+                                                 {
+                                                   CVUniverse::SetTruth(false);
+                                                   LoopAndFillEventSelection(options.m_mc, error_bands, configs, model, eventStore.get(), retry);
+                                                 },
+                                 {fluxLoad}, withStore({{"CVUniverse::SetTruth", "false"}, {"model", "MC reco loop"}, {"fluxReweighter", "event loops"}}, "MC reco loop"));
+  const auto truthLoop = stages.Add("Efficiency denominator loop", [&]()
+                                                                   {
+                                                                     CVUniverse::SetTruth(true);
+                                                                     LoopAndFillEffDenom(options.m_truth, truth_bands, configs, model, eventStore.get(), retry);
+                                                                   },
+                                    {fluxLoad}, withStore({{"CVUniverse::SetTruth", "true"}, {"model", "Efficiency denominator loop"}, {"fluxReweighter", "event loops"}}, "Efficiency denominator loop"));
+  const auto dataLoop = stages.Add("Data loop", [&]()
+                                                {
+                                                  CVUniverse::SetTruth(false);
+                                                  LoopAndFillData(options.m_data, data_band, configs, eventStore.get(), retry);
+                                                },
+                                   {}, withStore({{"CVUniverse::SetTruth", "false"}}, "Data loop"));
+  const auto fluxStage = stages.Add("Flux integrals", [&]()
+                                                      {
+                                                        for(const auto& fluxTemplate: fluxTemplates)
+                                                        {
+                                                          fluxIntegrals[fluxTemplate.first].reset(util::GetFluxIntegral(cv, fluxTemplate.second.get()));
+                                                        }
+                                                      },
+                                    {}, {{"fluxReweighter", "Flux integrals"}});
+
+  //MC and data writes touch different histograms, so each only waits for its own
+  //loops.  Variable2D's data histograms go in the MC file once both are done.
+  for(const auto config: configs)
+  {
+    const std::string suffix = config->name.empty()?"":" for " + config->name;
+    const auto writeMC = stages.Add("Write MC" + suffix, [&, config, suffix]()
+                                                         {
+                                                           std::cout << "MC cut summary" << suffix << ":\n" << *config->cuts << "\n";
+                                                           WriteMCResults(*config, fluxIntegrals, options.m_mc_pot, mcPreflight.skipped);
+                                                         },
+                                    {mcLoop, truthLoop, fluxStage});
+    stages.Add("Write data" + suffix, [config, suffix, &options, &dataPreflight]()
+                                      {
+                                        std::cout << "Data cut summary" << suffix << ":\n" << *config->dataCuts << "\n";
+                                        WriteDataResults(*config, options.m_data_pot, dataPreflight.skipped);
+                                      },
+               {dataLoop});
+    if(!config->vars2D.empty()) stages.Add("Write 2D data" + suffix, [config]() { WriteMC2DData(*config); }, {writeMC, dataLoop});
+  }
+
+  if(eventStore)
+  {
+    stages.Add("Write event store", [&]() { eventStore->Write(options.m_mc_pot, options.m_data_pot, nFiducialNucleons); },
+               {mcLoop, truthLoop, dataLoop});
+  }
+
+  // Loop entries and fill
+  try
+  {
+    options.PrintMacroConfiguration(argv[0]);
+    stages.Run(nThreads);
+    std::cout << "Time spent in each stage with " << nThreads << " threads:\n";
+    stages.PrintDurations(std::cout);
 
     std::cout << "Success" << std::endl;
   }
@@ -513,6 +1061,11 @@ int main(const int argc, const char** argv)
               << e.what() << "\n" << USAGE << "\n";
     return badFileRead;
   }
+  catch(const std::runtime_error& e)
+  {
+    std::cerr << e.what() << "\n";
+    return badOutputFile;
+  }
 
   return success;
 }
@@ -3,26 +3,41 @@
 #include "TFile.h"
 #include "TH1.h"
 #include "TH2.h"
+#include "TChain.h"
+#include "TLeaf.h"
+#include "TBranch.h"
 #include <PlotUtils/MnvH1D.h>
 #include <PlotUtils/MnvH2D.h>
 
 #include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio> //std::remove()
+#include <unistd.h> //fork()
+#include <sys/wait.h> //waitpid()
 typedef unsigned int uint;
 
 class MinModDepCCQEXSec : public XSec
 {
 public:
   MinModDepCCQEXSec(const char* name)
-    :XSec(name)
+    :XSec(name), fTreeNumber(-1), fIncoming(nullptr), fCurrent(nullptr), fPrimFSLepton(nullptr)
   {
   };
 
-bool isCCInclusiveSignal( PlotUtils::ChainWrapper& chw, int entry )
+bool isCCInclusiveSignal( PlotUtils::ChainWrapper& /*chw*/, int /*entry*/ )
 {
   double theta              = 0.;
-  double true_muon_px   = (double)chw.GetValue("mc_primFSLepton",entry,0)/1000;
-  double true_muon_py   = (double)chw.GetValue("mc_primFSLepton",entry,1)/1000;
-  double true_muon_pz   = (double)chw.GetValue("mc_primFSLepton",entry,2)/1000;
+  //mc_primFSLepton was read all at once by passesCuts()
+  double true_muon_px   = fPrimFSLepton->GetValue(0)/1000;
+  double true_muon_py   = fPrimFSLepton->GetValue(1)/1000;
+  double true_muon_pz   = fPrimFSLepton->GetValue(2)/1000;
   double numi_beam_angle_rad = -0.05887;
   double pyprime = -1.0*sin(numi_beam_angle_rad)*true_muon_pz + cos(numi_beam_angle_rad)*true_muon_py;
   double pzprime =  1.0*cos(numi_beam_angle_rad)*true_muon_pz + sin(numi_beam_angle_rad)*true_muon_py;
@@ -39,28 +54,38 @@ bool isCCInclusiveSignal( PlotUtils::ChainWrapper& chw, int entry )
   // include in this selection
   virtual bool passesCuts(PlotUtils::ChainWrapper& chw, int entry)
   {
-    if((int)chw.GetValue("mc_incoming", entry)!=14) return false;
-    if((int)chw.GetValue("mc_current", entry)!=1) return false;
+    //Look up branches by name only when the TChain moves to a new file
+    TChain* chain = chw.GetChain();
+    const Long64_t localEntry = chain->LoadTree(entry);
+    if(chain->GetTreeNumber() != fTreeNumber)
+    {
+      fTreeNumber = chain->GetTreeNumber();
+      fIncoming = chain->GetLeaf("mc_incoming");
+      fCurrent = chain->GetLeaf("mc_current");
+      fPrimFSLepton = chain->GetLeaf("mc_primFSLepton");
+    }
+
+    //Only read the branches each cut needs
+    fIncoming->GetBranch()->GetEntry(localEntry);
+    if((int)fIncoming->GetValue()!=14) return false;
+    fCurrent->GetBranch()->GetEntry(localEntry);
+    if((int)fCurrent->GetValue()!=1) return false;
+    fPrimFSLepton->GetBranch()->GetEntry(localEntry);
     if(!isCCInclusiveSignal  ( chw, entry ) ) return false;
-    
+
     return true;
   }
+
+private:
+  int fTreeNumber; //Which file in the TChain these leaves belong to
+  TLeaf* fIncoming;
+  TLeaf* fCurrent;
+  TLeaf* fPrimFSLepton;
 };
 
-int main(const int argc, const char** argv)
+//Run GENIEXSecExtract on every file in playlistFile.  Writes its histograms to outFileName.
+void runLoop(const std::string& playlistFile, const std::string& outFileName)
 {
-  //Read a playlist file from the command line
-  if(argc != 2)
-  {
-    std::cerr << "Expected exactly 1 command line argument, but got " << argc - 1 << ".\n\n"
-              << "USAGE: runXSecLooper <MCPlaylist.txt>\n\n"
-              << "MCPlaylist.txt shall contain one .root file per line that has a Truth tree in it.\n"
-              << "This program returns 0 when it suceeds.  It produces a .root file with GENIEXSECEXTRACT in its name.\n";
-    return 1;
-  }
-
-  const std::string playlistFile = argv[1]; //argv[0] is the name of the executable
-
   // Create the XSecLooper and tell it the input files
   // Inputs should be the merged ntuples:
   XSecLooper loop(playlistFile.c_str());
@@ -69,13 +94,13 @@ int main(const int argc, const char** argv)
   loop.setNuPDG(14);
 
   // Setting the number of Universes in the GENIE error band (default 100, put 0 if you do not want to include the universes)
-  loop.setNumUniv(0); 
+  loop.setNumUniv(0);
   loop.setFiducial(5980, 8422);
 
   // Add the differential cross section dsigma/ds_dpT
   double pt_edges[] = { 0.0, 0.075, 0.15, 0.25, 0.325, 0.4, 0.475, 0.55, 0.7, 0.85, 1.0, 1.25, 1.5, 2.5, 4.5 };
-  int pt_nbins = 14; 
- 
+  int pt_nbins = 14;
+
   // Flux-integrated over the range 0.0 to 100.0 GeV
   MinModDepCCQEXSec* ds_dpT = new MinModDepCCQEXSec("pT");
   ds_dpT->setBinEdges(pt_nbins, pt_edges);
@@ -83,20 +108,170 @@ int main(const int argc, const char** argv)
   ds_dpT->setIsFluxIntegrated(true);
   ds_dpT->setDimension(1);
   ds_dpT->setFluxIntLimits(0.0, 100.0);
-  ds_dpT->setNormalizationType(XSec::kPerNucleon);  
+  ds_dpT->setNormalizationType(XSec::kPerNucleon);
   ds_dpT->setUniverses(0); //default value, put 0 if you do not want universes to be included.
   loop.addXSec(ds_dpT);
 
   loop.runLoop();
 
   // Get the output histograms and save them to file
-  std::string geniefilename =  "GENIEXSECEXTRACT_" + playlistFile.substr(playlistFile.rfind("/")+1, playlistFile.find(".")) + ".root";
-  TFile fout(geniefilename.c_str(), "RECREATE");
+  TFile fout(outFileName.c_str(), "RECREATE");
   for(uint i=0; i<loop.getXSecs().size(); ++i)
   {
     loop.getXSecs()[i]->getXSecHist()->Write();
     loop.getXSecs()[i]->getEvRateHist()->Write();
   }
+}
+
+//Sum of POT_Used in each file's Meta tree.  This is what each XSecLooper normalized to.
+double countPOT(const std::vector<std::string>& files)
+{
+  TChain meta("Meta");
+  for(const auto& file: files) meta.Add(file.c_str());
+
+  double pot = 0, sum = 0;
+  meta.SetBranchStatus("*", false);
+  meta.SetBranchStatus("POT_Used", true);
+  meta.SetBranchAddress("POT_Used", &pot);
+  for(Long64_t entry = 0; entry < meta.GetEntries(); ++entry)
+  {
+    meta.GetEntry(entry);
+    sum += pot;
+  }
+  return sum;
+}
+
+//Event rates add.  Each cross section was normalized to its own POT, so weight them by POT.
+bool merge(const std::vector<std::string>& partFiles, const std::vector<double>& partPOTs, const std::string& outFileName)
+{
+  std::vector<std::unique_ptr<TH1>> xsecs, evRates;
+  double totalPOT = 0;
+  for(size_t whichPart = 0; whichPart < partFiles.size(); ++whichPart)
+  {
+    std::unique_ptr<TFile> part(TFile::Open(partFiles[whichPart].c_str(), "READ"));
+    if(!part) return false;
+
+    for(auto key: *part->GetListOfKeys())
+    {
+      std::unique_ptr<TH1> hist(dynamic_cast<TH1*>(part->Get(key->GetName())));
+      if(!hist) continue;
+      const bool isXSec = (std::string(hist->GetName()).find("xsec") != std::string::npos);
+      if(isXSec) hist->Scale(partPOTs[whichPart]);
+
+      auto& merged = isXSec?xsecs:evRates;
+      if(whichPart == 0) merged.emplace_back(std::move(hist));
+      else
+      {
+        auto found = std::find_if(merged.begin(), merged.end(), [&hist](const auto& other) { return std::string(other->GetName()) == hist->GetName(); });
+        if(found == merged.end()) return false;
+        (*found)->Add(hist.get());
+      }
+    }
+    totalPOT += partPOTs[whichPart];
+  }
+
+  if(totalPOT <= 0 || xsecs.size() != evRates.size()) return false;
+
+  TFile fout(outFileName.c_str(), "RECREATE");
+  for(size_t whichHist = 0; whichHist < xsecs.size(); ++whichHist)
+  {
+    xsecs[whichHist]->Scale(1./totalPOT);
+    xsecs[whichHist]->Write();
+    evRates[whichHist]->Write();
+  }
+  return true;
+}
+
+int main(const int argc, const char** argv)
+{
+  const std::string usage = "USAGE: runXSecLooper <MCPlaylist.txt> [-j <nWorkers>]\n\n"
+                            "MCPlaylist.txt shall contain one .root file per line that has a Truth tree in it.\n"
+                            "The files are split between nWorkers processes that each loop over their own files.\n"
+                            "nWorkers defaults to the number of cores on this machine.\n"
+                            "This program returns 0 when it suceeds.  It produces a .root file with GENIEXSECEXTRACT in its name.\n";
+
+  //Read a playlist file from the command line
+  if(argc != 2 && !(argc == 4 && std::string(argv[2]) == "-j"))
+  {
+    std::cerr << "Expected 1 or 3 command line arguments, but got " << argc - 1 << ".\n\n" << usage;
+    return 1;
+  }
+
+  const std::string playlistFile = argv[1]; //argv[0] is the name of the executable
+  std::string geniefilename =  "GENIEXSECEXTRACT_" + playlistFile.substr(playlistFile.rfind("/")+1, playlistFile.find(".")) + ".root";
+
+  std::vector<std::string> files;
+  std::ifstream playlist(playlistFile);
+  for(std::string file; playlist >> file;) files.push_back(file);
+
+  size_t nWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+  if(argc == 4)
+  {
+    try
+    {
+      nWorkers = std::stoul(argv[3]);
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Failed to parse the number of workers from " << argv[3] << ": " << e.what() << "\n\n" << usage;
+      return 1;
+    }
+  }
+  nWorkers = std::max<size_t>(std::min(nWorkers, files.size()), 1);
+
+  if(nWorkers == 1)
+  {
+    runLoop(playlistFile, geniefilename);
+    return 0;
+  }
+
+  //Each worker gets every nWorkers-th file.  GENIEXSecExtract's flux reweighter
+  //isn't thread-safe, so workers are separate processes with their own copies of it.
+  std::vector<std::string> partPlaylists, partFiles;
+  std::vector<double> partPOTs;
+  std::vector<pid_t> workers;
+  for(size_t whichWorker = 0; whichWorker < nWorkers; ++whichWorker)
+  {
+    std::vector<std::string> myFiles;
+    for(size_t whichFile = whichWorker; whichFile < files.size(); whichFile += nWorkers) myFiles.push_back(files[whichFile]);
+
+    partPlaylists.push_back(geniefilename + ".part" + std::to_string(whichWorker) + ".txt");
+    partFiles.push_back(geniefilename + ".part" + std::to_string(whichWorker) + ".root");
+    std::ofstream partPlaylist(partPlaylists.back());
+    for(const auto& file: myFiles) partPlaylist << file << "\n";
+    partPlaylist.close();
+    partPOTs.push_back(countPOT(myFiles));
+
+    const pid_t pid = fork();
+    if(pid < 0)
+    {
+      std::cerr << "Failed to start worker " << whichWorker << ".\n";
+      return 2;
+    }
+    if(pid == 0)
+    {
+      runLoop(partPlaylists.back(), partFiles.back());
+      _exit(0);
+    }
+    workers.push_back(pid);
+  }
+
+  bool allSucceeded = true;
+  for(const auto pid: workers)
+  {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    allSucceeded = allSucceeded && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+  }
+
+  if(!allSucceeded || !merge(partFiles, partPOTs, geniefilename))
+  {
+    std::cerr << "At least one worker failed.  Not writing " << geniefilename << ".\n";
+    return 3;
+  }
+
+  for(const auto& name: partPlaylists) std::remove(name.c_str());
+  for(const auto& name: partFiles) std::remove(name.c_str());
 
   return 0;
 }
@@ -7,24 +7,29 @@
 #include "event/CVUniverse.h"
 
 //c++ includes
-#include <functional> //for std::function
+#include <type_traits> //for std::decay_t
+#include <utility> //for std::forward
 
-class PerEventVarByGENIELabel: public Study
+//RECO is any callable that takes (const CVUniverse&, const MichelEvent&) and returns a double.
+//Its type is a template parameter instead of a std::function so that calls to it can be inlined.
+//Use MakePerEventVarByGENIELabel() to deduce RECO from a lambda.
+template <class RECO>
+class PerEventVarByGENIELabel final: public Study
 {
   public:
     //PerMichelVarByGENIELabel fills a histogram with 1 entry per Michel with some variable calculated from that Michel.  Your function will get to see the CVUniverse, the MichelEvent (= reconstructed Michels), and which Michel it's looping over.
-    using reco_t = std::function<double(const CVUniverse&, const MichelEvent&)>;
-
-    PerEventVarByGENIELabel(reco_t reco, const std::string& varName, const std::string& varUnits, const int nBins, const double minBin, const double maxBin, const std::map<std::string, std::vector<CVUniverse*>>& univs): Study(), fReco(reco)
+    //Only makes and fills histograms for universes in bands.  Empty bands means every band in univs.
+    PerEventVarByGENIELabel(RECO reco, const std::string& varName, const std::string& varUnits, const int nBins, const double minBin, const double maxBin, const std::map<std::string, std::vector<CVUniverse*>>& univs,
+                            const std::vector<std::string>& bands = {}): Study(bands), fReco(reco)
     {
       std::map<int, std::string> GENIELabels = {{1, "QE"},
                                                 {8, "2p2h"},
                                                 {2, "RES"},
                                                 {3, "DIS"}};
-      m_VarToGENIELabel = new util::Categorized<HIST, int>(varName, varName + " [" + varUnits + "]", GENIELabels, nBins, minBin, maxBin, univs);
+      m_VarToGENIELabel = new util::Categorized<HIST, int>(varName, varName + " [" + varUnits + "]", GENIELabels, nBins, minBin, maxBin, NeededUniverses(univs));
     }
 
-    void SaveOrDraw(TDirectory& outDir)
+    void SaveOrDraw(TDirectory& outDir) override
     {
        outDir.cd();
        m_VarToGENIELabel->visit([](HIST& wrapper)
@@ -39,21 +44,27 @@ class PerEventVarByGENIELabel: public Study
   private:
     using HIST = PlotUtils::HistWrapper<CVUniverse>;
 
-    reco_t fReco;
+    RECO fReco;
 
     util::Categorized<HIST, int>* m_VarToGENIELabel;
 
     //Overriding base class functions
     //Do nothing for now...  Good place for data comparisons in the future. 
-    void fillSelected(const CVUniverse& univ, const MichelEvent& evt, const double weight) {}
+    void fillSelected(const CVUniverse& univ, const MichelEvent& evt, const double weight) override {}
 
     //All of your plots happen here so far.
-    void fillSelectedSignal(const CVUniverse& univ, const MichelEvent& evt, const double weight)
+    void fillSelectedSignal(const CVUniverse& univ, const MichelEvent& evt, const double weight) override
     {
         
         (*m_VarToGENIELabel)[univ.GetInteractionType()].FillUniverse(&univ, fReco(univ, evt), weight);
     }
 
     //Do nothing for now...  Good place for efficiency denominators in the future.
-    void fillTruthSignal(const CVUniverse& univ, const MichelEvent& evt, const double weight) {}
+    void fillTruthSignal(const CVUniverse& univ, const MichelEvent& evt, const double weight) override {}
 };
+
+template <class RECO, class ...ARGS>
+PerEventVarByGENIELabel<std::decay_t<RECO>>* MakePerEventVarByGENIELabel(RECO&& reco, ARGS&&... args)
+{
+  return new PerEventVarByGENIELabel<std::decay_t<RECO>>(std::forward<RECO>(reco), std::forward<ARGS>(args)...);
+}
@@ -4,13 +4,27 @@
 //ROOT includes
 #include "TDirectory.h"
 
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
 class MichelEvent;
 class CVUniverse;
 
 class Study
 {
   public:
-    Study() {} //TODO: Any base constructor needed?
+    //bands are the names of the error bands this Study needs.  Empty means every band.
+    //The event loops only call a Study for universes in the bands it needs.
+    //"cv" is always needed because HistWrapper's CV is filled from it.
+    Study(const std::vector<std::string>& bands = {}): fBands(bands) {}
+
+    bool NeedsBand(const std::string& band) const
+    {
+      return fBands.empty() || band == "cv" || std::find(fBands.begin(), fBands.end(), band) != fBands.end();
+    }
 
     void Selected(const CVUniverse& univ, const MichelEvent& evt, const double weight)
     {
@@ -32,7 +46,21 @@ class Study
     //Only need this when you write a new Study.
     virtual void SaveOrDraw(TDirectory& outDir) = 0;
 
+  protected:
+    //Just the universes from the bands this Study needs.  Use these to make histograms.
+    std::map<std::string, std::vector<CVUniverse*>> NeededUniverses(const std::map<std::string, std::vector<CVUniverse*>>& univs) const
+    {
+      std::map<std::string, std::vector<CVUniverse*>> needed;
+      for(const auto& band: univs)
+      {
+        if(NeedsBand(band.first)) needed.insert(band);
+      }
+      return needed;
+    }
+
   private:
+    std::vector<std::string> fBands;
+
     using Hist = PlotUtils::HistWrapper<CVUniverse>;
 
     virtual void fillSelected(const CVUniverse& univ, const MichelEvent& evt, const double weight) = 0;
@@ -40,4 +68,20 @@ class Study
     virtual void fillTruthSignal(const CVUniverse& univ, const MichelEvent& evt, const double weight) = 0;
 };
 
+//The Studies that need each error band in bands.  Look this up once per band
+//in an event loop instead of asking every Study about every universe.
+inline std::map<std::string, std::vector<Study*>> StudiesByBand(const std::vector<Study*>& studies, const std::map<std::string, std::vector<CVUniverse*>>& bands)
+{
+  std::map<std::string, std::vector<Study*>> byBand;
+  for(const auto& band: bands)
+  {
+    auto& needed = byBand[band.first];
+    for(const auto study: studies)
+    {
+      if(study->NeedsBand(band.first)) needed.push_back(study);
+    }
+  }
+  return byBand;
+}
+
 #endif //STUDY_H
@@ -0,0 +1,201 @@
+//File: AllocationsPerEntry.cpp
+//Brief: Checks that EventSelectionEntry::Fill(), the body of runEventLoop's MC
+//       reco loop, doesn't allocate memory once the first few entries have been
+//       read.  Replaces the global operator new with one that counts calls.
+//
+//       The AnalysisConfig only has cuts on CVUniverse's own branches, and the
+//       Model has one stub Reweighter, because MINERvA's reweighters and muon
+//       cuts need tables from MPARAMFILESROOT and branches that aren't in the
+//       test tuple.  Every branch fits in one basket, so ROOT never has to read
+//       a new basket in the middle of the loop.
+//
+//       Returns 0 if no entry after the warm-up allocated.
+
+//Includes from this package
+#include "event/CVUniverse.h"
+#include "event/MichelEvent.h"
+#include "util/AnalysisConfig.h"
+#include "util/EventSelectionEntry.h"
+#include "util/Variable.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/ChainWrapper.h"
+#include "PlotUtils/CCInclusiveCuts.h"
+#include "PlotUtils/CCInclusiveSignal.h"
+#include "PlotUtils/Cutter.h"
+#include "PlotUtils/Model.h"
+#include "PlotUtils/Reweighter.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+
+//c++ includes
+#include <iostream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdio> //std::remove()
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace
+{
+  std::atomic<bool> counting(false);
+  std::atomic<size_t> nAllocations(0);
+
+  void* countedAlloc(const size_t size)
+  {
+    if(counting) ++nAllocations;
+    void* memory = std::malloc(size?size:1);
+    if(!memory) throw std::bad_alloc();
+    return memory;
+  }
+
+  constexpr int nEntries = 100, nWarmup = 2;
+
+  //Reads a branch like a real Reweighter without needing MPARAMFILESROOT
+  class StubReweighter: public PlotUtils::Reweighter<CVUniverse, MichelEvent>
+  {
+    public:
+      double GetWeight(const CVUniverse& univ, const MichelEvent& /*evt*/) const override
+      {
+        return 1. + 0.01 * univ.GetInteractionType();
+      }
+
+      std::string GetName() const override { return "Stub"; }
+      bool DependsReco() const override { return false; }
+  };
+
+  //One entry per branch in event/AnaTupleBranches.schema
+  void writeTuple(const std::string& fileName, const std::string& treeName, const std::string& anaTool)
+  {
+    TFile file(fileName.c_str(), "RECREATE");
+    TTree tree(treeName.c_str(), treeName.c_str());
+
+    double vtx[4], mc_vtx[4], recoil_summed_energy[3];
+    int recoil_summed_energy_sz = 3, mc_current, mc_incoming, mc_intType, mc_targetNucleon, isMinosMatchTrack, tDead;
+    double mc_Bjorkenx, mc_Bjorkeny, recoilE_SplineCorrected, qsquared_recoil, minos_trk_qp;
+
+    tree.Branch("vtx", vtx, "vtx[4]/D");
+    tree.Branch("mc_vtx", mc_vtx, "mc_vtx[4]/D");
+    tree.Branch("recoil_summed_energy_sz", &recoil_summed_energy_sz, "recoil_summed_energy_sz/I");
+    tree.Branch("recoil_summed_energy", recoil_summed_energy, "recoil_summed_energy[recoil_summed_energy_sz]/D");
+    tree.Branch("mc_current", &mc_current, "mc_current/I");
+    tree.Branch("mc_incoming", &mc_incoming, "mc_incoming/I");
+    tree.Branch("mc_intType", &mc_intType, "mc_intType/I");
+    tree.Branch("mc_targetNucleon", &mc_targetNucleon, "mc_targetNucleon/I");
+    tree.Branch("mc_Bjorkenx", &mc_Bjorkenx, "mc_Bjorkenx/D");
+    tree.Branch("mc_Bjorkeny", &mc_Bjorkeny, "mc_Bjorkeny/D");
+    tree.Branch("recoilE_SplineCorrected", &recoilE_SplineCorrected, "recoilE_SplineCorrected/D");
+    tree.Branch("qsquared_recoil", &qsquared_recoil, "qsquared_recoil/D");
+    tree.Branch("isMinosMatchTrack", &isMinosMatchTrack, "isMinosMatchTrack/I");
+    tree.Branch((anaTool + "_minos_trk_qp").c_str(), &minos_trk_qp, (anaTool + "_minos_trk_qp/D").c_str());
+    tree.Branch("phys_n_dead_discr_pair_upstream_prim_track_proj", &tDead, "phys_n_dead_discr_pair_upstream_prim_track_proj/I");
+
+    for(int entry = 0; entry < nEntries; ++entry)
+    {
+      //Alternate between passing and failing the tracker's z range
+      vtx[0] = mc_vtx[0] = 10. * entry;
+      vtx[1] = mc_vtx[1] = -5. * entry;
+      vtx[2] = mc_vtx[2] = (entry % 2)?7000.:100.;
+      vtx[3] = mc_vtx[3] = 0;
+      for(int whichRecoil = 0; whichRecoil < recoil_summed_energy_sz; ++whichRecoil) recoil_summed_energy[whichRecoil] = 100. * whichRecoil + entry;
+      mc_current = 1 + entry % 2;
+      mc_incoming = 14;
+      mc_intType = 1 + entry % 3;
+      mc_targetNucleon = 2112;
+      mc_Bjorkenx = 0.01 * entry;
+      mc_Bjorkeny = 0.005 * entry;
+      recoilE_SplineCorrected = 50. + entry;
+      qsquared_recoil = 1e5 + entry;
+      isMinosMatchTrack = entry % 2;
+      minos_trk_qp = -0.1;
+      tDead = 0;
+      tree.Fill();
+    }
+
+    tree.Write();
+  }
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+
+int main(const int /*argc*/, const char** /*argv*/)
+{
+  const std::string treeName = "MasterAnaDev", fileName = "AllocationsPerEntry_tuple.root";
+
+  PlotUtils::ChainWrapper chw(treeName.c_str());
+  std::map<std::string, std::vector<CVUniverse*>> bands;
+  bands["cv"] = {new CVUniverse(&chw)};
+  bands["shifted"] = {new CVUniverse(&chw, 1)};
+
+  const std::string anaTool = bands["cv"].front()->GetAnaToolName();
+  writeTuple(fileName, treeName, anaTool);
+  chw.Add(fileName);
+
+  const auto missing = CVUniverse::MissingBranches(*chw.GetChain(), anaTool, CVUniverse::reco | CVUniverse::mcReco);
+  for(const auto& branch: missing) std::cerr << "Test tuple is missing " << branch << ".  Update writeTuple() to match event/AnaTupleBranches.schema.\n";
+  if(!missing.empty()) return 2;
+
+  //Nominal cuts that only read CVUniverse's own branches
+  PlotUtils::Cutter<CVUniverse, MichelEvent>::reco_t preCuts, sidebands;
+  PlotUtils::Cutter<CVUniverse, MichelEvent>::truth_t signal, phaseSpace;
+  preCuts.emplace_back(new reco::ZRange<CVUniverse, MichelEvent>("Tracker", 5980, 8422));
+  preCuts.emplace_back(new reco::Apothem<CVUniverse, MichelEvent>(850));
+  preCuts.emplace_back(new reco::HasMINOSMatch<CVUniverse, MichelEvent>());
+  signal.emplace_back(new truth::IsNeutrino<CVUniverse>());
+  signal.emplace_back(new truth::IsCC<CVUniverse>());
+  phaseSpace.emplace_back(new truth::ZRange<CVUniverse>("Tracker", 5980, 8422));
+  phaseSpace.emplace_back(new truth::Apothem<CVUniverse>(850));
+
+  AnalysisConfig config;
+  config.cuts.reset(new PlotUtils::Cutter<CVUniverse, MichelEvent>(std::move(preCuts), std::move(sidebands), std::move(signal), std::move(phaseSpace)));
+  config.vars.push_back(new Variable("recoil", "recoil [MeV]", std::vector<double>{0, 100, 200, 300, 400, 500},
+                                     &CVUniverse::GetRecoilE, &CVUniverse::GetEavail));
+  for(const auto var: config.vars) var->InitializeMCHists(bands, bands);
+
+  std::vector<std::unique_ptr<PlotUtils::Reweighter<CVUniverse, MichelEvent>>> reweighters;
+  reweighters.emplace_back(new StubReweighter());
+  PlotUtils::Model<CVUniverse, MichelEvent> model(std::move(reweighters));
+
+  EventSelectionEntry entryFiller(bands, {&config}, model, nullptr, nullptr);
+  CVUniverse* cv = bands["cv"].front();
+
+  size_t nFailures = 0;
+  for(int entry = 0; entry < nEntries; ++entry)
+  {
+    nAllocations = 0;
+    counting = (entry >= nWarmup);
+
+    cv->SetEntry(entry);
+    entryFiller.Fill(entry);
+
+    counting = false;
+    if(nAllocations > 0)
+    {
+      std::cerr << "Entry " << entry << " allocated " << nAllocations.load() << " times.\n";
+      ++nFailures;
+    }
+  }
+
+  std::remove(fileName.c_str());
+  if(nFailures > 0)
+  {
+    std::cerr << nFailures << " of " << nEntries - nWarmup << " entries after the warm-up allocated memory.\n";
+    return 1;
+  }
+
+  std::cout << "No allocations in " << nEntries - nWarmup << " entries after the warm-up.\n";
+  return 0;
+}
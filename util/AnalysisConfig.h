@@ -0,0 +1,158 @@
+//File: AnalysisConfig.h
+//Brief: Everything that can change between analyses of the same events: the
+//       fiducial volume, phase space, sidebands, and the Variables and Studies
+//       to fill.  runEventLoop's event loops fill every AnalysisConfig at once
+//       so that they share reading each entry, decoding its branches, and
+//       calculating its Model weights.
+
+#ifndef UTIL_ANALYSISCONFIG_H
+#define UTIL_ANALYSISCONFIG_H
+
+//Includes from this package
+#include "event/CVUniverse.h"
+#include "event/MichelEvent.h"
+#include "util/Variable.h"
+#include "util/Variable2D.h"
+#include "studies/Study.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/CCInclusiveCuts.h"
+#include "PlotUtils/CCInclusiveSignal.h"
+#include "PlotUtils/Cutter.h"
+#include "PlotUtils/TargetUtils.h"
+#pragma GCC diagnostic pop
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <bitset>
+#include <memory>
+#include <stdexcept>
+
+struct AnalysisConfig
+{
+  std::string name; //Empty for the nominal analysis
+
+  //Fiducial volume and phase space
+  double minZ = 5980, maxZ = 8422, apothem = 850; //All in mm
+  double maxMuonAngle = 20; //degrees
+  double minPzMu = 1500; //MeV/c
+
+  //A region where every cut in cutNames fails and every other cut passes.
+  //Cut names are the keys of recoCuts in BuildCutter().
+  struct Sideband
+  {
+    std::string name;
+    std::vector<std::string> cutNames;
+    std::bitset<64> expected; //What isMCSelected() returns for events in this sideband
+  };
+  std::vector<Sideband> sidebands;
+
+  //Data gets its own Cutter so that the data loop can run alongside the MC
+  //loops without sharing the Cutter's statistics.
+  std::unique_ptr<PlotUtils::Cutter<CVUniverse, MichelEvent>> cuts, dataCuts;
+  std::vector<Variable*> vars, fineVars;
+  std::vector<Variable2D*> vars2D;
+  std::vector<Study*> studies, dataStudies;
+
+  //The event loops fill the fine-binned copies just like any other Variable
+  std::vector<Variable*> LoopVars() const
+  {
+    std::vector<Variable*> loopVars = vars;
+    loopVars.insert(loopVars.end(), fineVars.begin(), fineVars.end());
+    return loopVars;
+  }
+
+  //Always use MC number of nucleons for cross section
+  double FiducialNucleons() const
+  {
+    PlotUtils::TargetUtils targetInfo;
+    return targetInfo.GetTrackerNNucleons(minZ, maxZ, true, apothem);
+  }
+
+  //name inserted before .root so each configuration gets its own files
+  std::string FileName(const std::string& nominal) const
+  {
+    if(name.empty()) return nominal;
+    return nominal.substr(0, nominal.rfind(".root")) + "_" + name + ".root";
+  }
+
+  //Now that we've defined what a cross section is, decide which sample and model
+  //we're extracting a cross section for.
+  //Throws std::invalid_argument if a Sideband inverts a cut that doesn't exist.
+  void MakeCuts()
+  {
+    cuts = BuildCutter();
+    dataCuts = BuildCutter();
+  }
+
+  //Which of sidebands a result from isMCSelected() or isDataSelected() is in.
+  //-1 for events in the signal region or in no region at all.
+  int WhichSideband(const std::bitset<64>& selected) const
+  {
+    for(size_t whichSideband = 0; whichSideband < sidebands.size(); ++whichSideband)
+    {
+      if(selected == sidebands[whichSideband].expected) return whichSideband;
+    }
+    return -1;
+  }
+
+  private:
+    std::unique_ptr<PlotUtils::Cutter<CVUniverse, MichelEvent>> BuildCutter()
+    {
+      PlotUtils::Cutter<CVUniverse, MichelEvent>::reco_t sidebandCuts, preCuts;
+      PlotUtils::Cutter<CVUniverse, MichelEvent>::truth_t signalDefinition, phaseSpace;
+
+      std::vector<std::pair<std::string, std::unique_ptr<PlotUtils::Cut<CVUniverse, MichelEvent>>>> recoCuts;
+      recoCuts.emplace_back("zRange", new reco::ZRange<CVUniverse, MichelEvent>("Tracker", minZ, maxZ));
+      recoCuts.emplace_back("apothem", new reco::Apothem<CVUniverse, MichelEvent>(apothem));
+      recoCuts.emplace_back("muonAngle", new reco::MaxMuonAngle<CVUniverse, MichelEvent>(maxMuonAngle));
+      recoCuts.emplace_back("MINOSMatch", new reco::HasMINOSMatch<CVUniverse, MichelEvent>());
+      recoCuts.emplace_back("deadtime", new reco::NoDeadtime<CVUniverse, MichelEvent>(1, "Deadtime"));
+      recoCuts.emplace_back("isNeutrino", new reco::IsNeutrino<CVUniverse, MichelEvent>());
+
+      //Cuts that some Sideband inverts go to the Cutter as sideband cuts.  The Cutter
+      //still requires them for the signal region, but it reports which ones failed.
+      //Everything else stays a precut that every region has to pass.
+      std::set<std::string> inverted;
+      for(const auto& sideband: sidebands) inverted.insert(sideband.cutNames.begin(), sideband.cutNames.end());
+
+      std::map<std::string, size_t> whichBit;
+      for(auto& cut: recoCuts)
+      {
+        if(inverted.count(cut.first))
+        {
+          whichBit[cut.first] = sidebandCuts.size();
+          sidebandCuts.push_back(std::move(cut.second));
+        }
+        else preCuts.push_back(std::move(cut.second));
+      }
+
+      for(auto& sideband: sidebands)
+      {
+        sideband.expected.set();
+        for(const auto& cutName: sideband.cutNames)
+        {
+          const auto found = whichBit.find(cutName);
+          if(found == whichBit.end()) throw std::invalid_argument("Sideband " + sideband.name + " inverts a cut named " + cutName + " that doesn't exist");
+          sideband.expected.reset(found->second);
+        }
+      }
+
+      signalDefinition.emplace_back(new truth::IsNeutrino<CVUniverse>());
+      signalDefinition.emplace_back(new truth::IsCC<CVUniverse>());
+
+      phaseSpace.emplace_back(new truth::ZRange<CVUniverse>("Tracker", minZ, maxZ));
+      phaseSpace.emplace_back(new truth::Apothem<CVUniverse>(apothem));
+      phaseSpace.emplace_back(new truth::MuonAngle<CVUniverse>(maxMuonAngle));
+      phaseSpace.emplace_back(new truth::PZMuMin<CVUniverse>(minPzMu));
+
+      return std::unique_ptr<PlotUtils::Cutter<CVUniverse, MichelEvent>>(new PlotUtils::Cutter<CVUniverse, MichelEvent>(std::move(preCuts), std::move(sidebandCuts) , std::move(signalDefinition),std::move(phaseSpace)));
+    }
+};
+
+#endif //UTIL_ANALYSISCONFIG_H
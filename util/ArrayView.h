@@ -0,0 +1,95 @@
+//File: ArrayView.h
+//Brief: A non-owning view of an array branch's values for the current entry.
+//       A LeafHandle finds an array branch's TLeaf once per file in a TChain, and
+//       Get() points straight into the buffer ROOT already read the entry into.
+//       CVUniverse uses these instead of GetVec(), which copies every element
+//       into a new std::vector and looks the branch up by name on every call.
+
+#ifndef UTIL_ARRAYVIEW_H
+#define UTIL_ARRAYVIEW_H
+
+//ROOT includes
+#include "TChain.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+
+//c++ includes
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+namespace util
+{
+  template <class T>
+  class ArrayView
+  {
+    public:
+      ArrayView(const T* begin, const size_t size): fBegin(begin), fSize(size) {}
+
+      const T* data() const { return fBegin; }
+      size_t size() const { return fSize; }
+      bool empty() const { return fSize == 0; }
+
+      const T* begin() const { return fBegin; }
+      const T* end() const { return fBegin + fSize; }
+
+      const T& operator [](const size_t index) const { return fBegin[index]; }
+
+      //Throws std::out_of_range like std::vector::at()
+      const T& at(const size_t index) const
+      {
+        if(index >= fSize) throw std::out_of_range("Index " + std::to_string(index) + " is past the end of an array with " + std::to_string(fSize) + " elements");
+        return fBegin[index];
+      }
+
+    private:
+      const T* fBegin;
+      size_t fSize;
+  };
+
+  //One per branch per object that reads it.  Not thread-safe, but neither is a TChain.
+  class LeafHandle
+  {
+    public:
+      explicit LeafHandle(const std::string& branchName): fName(branchName), fLeaf(nullptr), fTreeNumber(-1) {}
+
+      //The view is only valid until the TChain reads another entry of this branch.
+      //Throws std::runtime_error if chain has no branch with this name or its
+      //elements aren't the same size as T.
+      template <class T>
+      ArrayView<T> Get(TChain& chain, const Long64_t entry)
+      {
+        const auto leaf = Load(chain, entry);
+        if(leaf->GetLenType() != static_cast<int>(sizeof(T))) throw std::runtime_error("Branch " + fName + " holds " + leaf->GetTypeName() + ", not what it was read as.");
+        return ArrayView<T>(static_cast<const T*>(leaf->GetValuePointer()), leaf->GetLen());
+      }
+
+      //First element converted to double like ChainWrapper::GetValue() does
+      double GetValue(TChain& chain, const Long64_t entry)
+      {
+        return Load(chain, entry)->GetValue(0);
+      }
+
+    private:
+      std::string fName;
+      TLeaf* fLeaf; //Belongs to the TChain's current TTree
+      int fTreeNumber; //Which file in the TChain fLeaf came from
+
+      //Throws std::runtime_error if chain has no branch named fName
+      TLeaf* Load(TChain& chain, const Long64_t entry)
+      {
+        const Long64_t localEntry = chain.LoadTree(entry);
+        if(chain.GetTreeNumber() != fTreeNumber)
+        {
+          fLeaf = chain.GetLeaf(fName.c_str());
+          if(!fLeaf) throw std::runtime_error("Failed to find a branch named " + fName);
+          fTreeNumber = chain.GetTreeNumber();
+        }
+
+        fLeaf->GetBranch()->GetEntry(localEntry); //Doesn't read again if this entry is already loaded
+        return fLeaf;
+      }
+  };
+}
+
+#endif //UTIL_ARRAYVIEW_H
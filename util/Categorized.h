@@ -4,6 +4,11 @@
 //       which NamedCategory<> a value belongs to.  Useful for putting together
 //       stacked histograms that compare different "channels" with how they
 //       contribute to the total histogram for a value.
+//
+//       Integer categories, like background types and GENIE interaction
+//       types, are looked up in a flat table instead of a hash map when
+//       their values are close enough together.  CategorizedGrid<> crosses
+//       two sets of integer categories.
 //Author: Andrew Olivier aolivier@ur.rochester.edu
 
 #ifndef UTIL_CATEGORIZED_CPP
@@ -19,6 +24,8 @@
 #include <unordered_map>
 #endif //__CINT__
 #include <set>
+#include <map>
+#include <algorithm>
 
 namespace util
 {
@@ -145,6 +152,201 @@ namespace util
       #endif //__CINT__
       HIST* fOther; //All entries that don't fit in any other CATEGORY end up in this HIST
   };
+
+  #ifndef __CINT__ //Hide c++11 features from CINT
+  namespace detail
+  {
+    //Maps each integer category to a slot in a flat table.  Values that aren't
+    //a category, including everything outside [min, max], map to the last slot
+    //which is always "Other".  That clamp is a std::min() instead of a branch.
+    //Categories spread over more than maxSpan values, like nuclear PDG codes,
+    //are looked up in a hash map instead so the table doesn't take gigabytes.
+    class DenseAxis
+    {
+      public:
+        static constexpr long long maxSpan = 1 << 16;
+
+        DenseAxis() = default;
+
+        //Categories are each value that maps to slot i for all i.
+        DenseAxis(const std::vector<std::vector<int>>& categories)
+        {
+          std::vector<int> allValues;
+          for(const auto& category: categories) allValues.insert(allValues.end(), category.begin(), category.end());
+
+          fNSlots = categories.size() + 1;
+          if(allValues.empty())
+          {
+            fSlots.assign(1, fNSlots - 1);
+            return;
+          }
+
+          fMin = *std::min_element(allValues.begin(), allValues.end());
+          const long long max = *std::max_element(allValues.begin(), allValues.end());
+          if(max - fMin > maxSpan)
+          {
+            for(size_t whichCat = 0; whichCat < categories.size(); ++whichCat)
+            {
+              for(const int value: categories[whichCat]) fSparse[value] = whichCat;
+            }
+            return;
+          }
+
+          //One more entry past max for every value that isn't a category
+          fSlots.assign(max - fMin + 2, fNSlots - 1);
+          for(size_t whichCat = 0; whichCat < categories.size(); ++whichCat)
+          {
+            for(const int value: categories[whichCat]) fSlots[value - fMin] = whichCat;
+          }
+        }
+
+        size_t operator ()(const int value) const
+        {
+          if(fSlots.empty())
+          {
+            const auto found = fSparse.find(value);
+            return (found == fSparse.end())?fNSlots - 1:found->second;
+          }
+
+          //Values below fMin wrap around to huge numbers and get clamped too
+          const size_t index = static_cast<unsigned long long>(value - fMin);
+          return fSlots[std::min(index, fSlots.size() - 1)];
+        }
+
+        //Number of categories plus 1 for Other
+        size_t size() const { return fNSlots; }
+
+      private:
+        long long fMin = 0;
+        size_t fNSlots = 1;
+        std::vector<size_t> fSlots; //Empty when categories are in fSparse instead
+        std::unordered_map<int, size_t> fSparse;
+    };
+  }
+
+  //Specialization for integer categories.  Same interface as Categorized<> above,
+  //but operator []() is a table lookup and visit() doesn't allocate anything.
+  template <class HIST>
+  class Categorized<HIST, int>
+  {
+    public:
+      template <class ...HISTARGS>
+      Categorized(const std::vector<NamedCategory<int>>& categories, const std::string& baseName,
+                  const std::string& axes, HISTARGS... args)
+      {
+        std::vector<std::vector<int>> values;
+        for(const auto& category: categories)
+        {
+          fHists.push_back(new HIST(SafeROOTName(baseName + "_" + category.name).c_str(), (category.name + ";" + axes).c_str(), args...));
+          values.push_back(category.values);
+        }
+
+        fHists.push_back(new HIST((baseName + "_Other").c_str(), ("Other;" + axes).c_str(), args...));
+        MakeTable(values);
+      }
+
+      //Use a std::map<> instead of CATEGORIES
+      template <class ...HISTARGS>
+      Categorized(const std::string& baseName, const std::string& axes,
+                  const std::map<int, std::string> categories, HISTARGS... args)
+      {
+        std::vector<std::vector<int>> values;
+        for(const auto& category: categories)
+        {
+          fHists.push_back(new HIST(SafeROOTName(baseName + "_" + category.second).c_str(), (category.second + ";" + axes).c_str(), args...));
+          values.push_back({category.first});
+        }
+
+        fHists.push_back(new HIST((baseName + "_Other").c_str(), ("Other;" + axes).c_str(), args...));
+        MakeTable(values);
+      }
+
+      HIST& operator [](const int cat) const
+      {
+        return *fHists[fAxis(cat)];
+      }
+
+      //Apply a callable object, of type FUNC, to each histogram this object manages.
+      //FUNC takes only a reference to the histogram as argument.  Other is last.
+      template <class FUNC>
+      void visit(FUNC&& func)
+      {
+        for(auto hist: fHists) func(*hist);
+      }
+
+    private:
+      //All HISTs are referred to as observer pointers for compatability with TH1s created in a TFile.
+      //The TFile is responsible for deleting them.
+      std::vector<HIST*> fHists; //Each HIST exactly once in the order categories were given with Other last
+      detail::DenseAxis fAxis; //Category -> index in fHists
+
+      void MakeTable(const std::vector<std::vector<int>>& values)
+      {
+        fAxis = detail::DenseAxis(values);
+      }
+  };
+
+  //A HIST for every combination of categories on 2 integer axes, like background
+  //type by GENIE interaction type.  Each axis has its own Other category.
+  //All HISTs live in one flat table, so looking one up is 2 array accesses.
+  template <class HIST>
+  class CategorizedGrid
+  {
+    public:
+      template <class ...HISTARGS>
+      CategorizedGrid(const std::string& baseName, const std::string& axes,
+                      const std::map<int, std::string>& xCategories,
+                      const std::map<int, std::string>& yCategories, HISTARGS... args)
+      {
+        std::vector<std::vector<int>> xValues, yValues;
+        std::vector<std::string> xNames, yNames;
+        for(const auto& category: xCategories)
+        {
+          xValues.push_back({category.first});
+          xNames.push_back(category.second);
+        }
+        xNames.push_back("Other");
+
+        for(const auto& category: yCategories)
+        {
+          yValues.push_back({category.first});
+          yNames.push_back(category.second);
+        }
+        yNames.push_back("Other");
+
+        fX = detail::DenseAxis(xValues);
+        fY = detail::DenseAxis(yValues);
+
+        //Row-major in y so that each x category's HISTs are next to each other
+        for(const auto& xName: xNames)
+        {
+          for(const auto& yName: yNames)
+          {
+            const std::string name = xName + "_" + yName;
+            fHists.push_back(new HIST(SafeROOTName(baseName + "_" + name).c_str(), (name + ";" + axes).c_str(), args...));
+          }
+        }
+      }
+
+      HIST& operator ()(const int x, const int y) const
+      {
+        return *fHists[fX(x) * fY.size() + fY(y)];
+      }
+
+      //Same as Categorized<>::visit().  Other comes last on each axis.
+      template <class FUNC>
+      void visit(FUNC&& func)
+      {
+        for(auto hist: fHists) func(*hist);
+      }
+
+    private:
+      //Observer pointers like Categorized<>
+      std::vector<HIST*> fHists;
+      detail::DenseAxis fX;
+      detail::DenseAxis fY;
+  };
+  #endif //__CINT__
 }
 
 #endif //UTIL_CATEGORIZED_CPP
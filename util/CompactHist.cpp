@@ -0,0 +1,246 @@
+//File: CompactHist.cpp
+//Brief: An alternative to writing MnvH1Ds and MnvH2Ds with one TH1 per universe.
+//       A compact histogram is a TTree with the same name as the histogram and
+//       1 entry per error band.  Each entry holds every universe's bin contents and
+//       squared errors as one dense (universe x bin) array.  The CV with its
+//       binning and any pushed covariance matrices are in the TTree's UserInfo.
+//       Reading one back only reads the error bands asked for.
+//
+//       runEventLoop writes compact histograms when MNV101_COMPACT_OUTPUT is set.
+//       util::GetIngredient() turns them back into MnvH1Ds and MnvH2Ds automatically.
+
+//Includes from this package
+#include "util/CompactHist.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#include "PlotUtils/MnvH2D.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TTree.h"
+#include "TFile.h"
+#include "TDirectory.h"
+#include "TMap.h"
+#include "TObjString.h"
+#include "TMatrixD.h"
+
+//c++ includes
+#include <cstdlib>
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+namespace
+{
+  //Everything in one entry of a compact histogram's TTree
+  struct BandRow
+  {
+    std::string band;
+    bool isLateral;
+    bool useSpreadError;
+    int nUniverses;
+    std::vector<double> content; //[universe * nBins + bin]
+    std::vector<double> err2; //Same layout as content
+  };
+
+  template <class BAND>
+  void Flatten(const BAND& band, BandRow& row)
+  {
+    row.nUniverses = band.GetNHists();
+    row.useSpreadError = band.GetUseSpreadError();
+    row.content.clear();
+    row.err2.clear();
+    for(int whichUniv = 0; whichUniv < row.nUniverses; ++whichUniv)
+    {
+      const auto univ = band.GetHist(whichUniv);
+      for(int whichBin = 0; whichBin < univ->GetNcells(); ++whichBin)
+      {
+        row.content.push_back(univ->GetBinContent(whichBin));
+        row.err2.push_back(univ->GetBinError(whichBin) * univ->GetBinError(whichBin));
+      }
+    }
+  }
+
+  template <class BAND>
+  void Unflatten(const BandRow& row, BAND& band)
+  {
+    band.SetUseSpreadError(row.useSpreadError);
+    for(int whichUniv = 0; whichUniv < row.nUniverses; ++whichUniv)
+    {
+      auto univ = band.GetHist(whichUniv);
+      const int nBins = univ->GetNcells();
+      for(int whichBin = 0; whichBin < nBins; ++whichBin)
+      {
+        univ->SetBinContent(whichBin, row.content[whichUniv * nBins + whichBin]);
+        univ->SetBinError(whichBin, std::sqrt(row.err2[whichUniv * nBins + whichBin]));
+      }
+    }
+  }
+
+  //Only MnvH1D has covariance matrices to keep
+  void SaveCovMatrices(const PlotUtils::MnvH1D& hist, TList& userInfo)
+  {
+    auto covs = new TMap();
+    covs->SetName("covMatrices");
+    for(const auto& name: hist.GetSysErrorMatricesNames()) covs->Add(new TObjString(name.c_str()), new TMatrixD(hist.GetSysErrorMatrix(name)));
+    userInfo.Add(covs);
+  }
+
+  void SaveCovMatrices(const PlotUtils::MnvH2D& /*hist*/, TList& /*userInfo*/)
+  {
+  }
+
+  void LoadCovMatrices(TList& userInfo, PlotUtils::MnvH1D& hist)
+  {
+    auto covs = dynamic_cast<TMap*>(userInfo.FindObject("covMatrices"));
+    if(!covs) return;
+
+    TIter next(covs);
+    while(auto key = next()) hist.PushCovMatrix(key->GetName(), *static_cast<TMatrixD*>(covs->GetValue(key)));
+  }
+
+  void LoadCovMatrices(TList& /*userInfo*/, PlotUtils::MnvH2D& /*hist*/)
+  {
+  }
+
+  template <class MNVHIST>
+  void WriteCompact(const MNVHIST& hist, TDirectory& dir, const std::string& name)
+  {
+    TDirectory::TContext inDir(&dir); //New TTrees go in the current directory
+
+    BandRow row;
+    TTree tree(name.c_str(), util::compactTitle);
+    tree.Branch("band", &row.band);
+    tree.Branch("isLateral", &row.isLateral);
+    tree.Branch("useSpreadError", &row.useSpreadError);
+    tree.Branch("nUniverses", &row.nUniverses);
+    tree.Branch("content", &row.content);
+    tree.Branch("err2", &row.err2);
+
+    auto cv = hist.GetCVHistoWithStatError().Clone("cv");
+    tree.GetUserInfo()->Add(cv);
+    SaveCovMatrices(hist, *tree.GetUserInfo());
+
+    for(const auto& bandName: hist.GetVertErrorBandNames())
+    {
+      row.band = bandName;
+      row.isLateral = false;
+      Flatten(*hist.GetVertErrorBand(bandName), row);
+      tree.Fill();
+    }
+
+    for(const auto& bandName: hist.GetLatErrorBandNames())
+    {
+      row.band = bandName;
+      row.isLateral = true;
+      Flatten(*hist.GetLatErrorBand(bandName), row);
+      tree.Fill();
+    }
+
+    tree.Write();
+  }
+
+  template <class MNVHIST, class HIST>
+  MNVHIST* ReadCompact(TObject& obj, const std::vector<std::string>& bands)
+  {
+    auto tree = dynamic_cast<TTree*>(&obj);
+    if(!tree || std::string(tree->GetTitle()) != util::compactTitle) return nullptr;
+
+    auto cv = dynamic_cast<HIST*>(tree->GetUserInfo()->FindObject("cv"));
+    if(!cv) return nullptr; //Wrong dimension
+
+    //New error bands copy the CV, so start with it
+    auto hist = new MNVHIST(*cv);
+    hist->SetName(tree->GetName());
+    LoadCovMatrices(*tree->GetUserInfo(), *hist);
+
+    BandRow row;
+    auto bandName = &row.band;
+    auto content = &row.content, err2 = &row.err2;
+    tree->SetBranchAddress("band", &bandName);
+    tree->SetBranchAddress("isLateral", &row.isLateral);
+    tree->SetBranchAddress("useSpreadError", &row.useSpreadError);
+    tree->SetBranchAddress("nUniverses", &row.nUniverses);
+    tree->SetBranchAddress("content", &content);
+    tree->SetBranchAddress("err2", &err2);
+
+    //Decide which bands to read from just their names.  Skipped bands' universes are never decompressed.
+    auto nameBranch = tree->GetBranch("band");
+    for(Long64_t entry = 0; entry < tree->GetEntries(); ++entry)
+    {
+      nameBranch->GetEntry(entry);
+      if(!bands.empty() && std::find(bands.begin(), bands.end(), row.band) == bands.end()) continue;
+
+      tree->GetEntry(entry);
+      if(row.isLateral)
+      {
+        hist->AddLatErrorBand(row.band, row.nUniverses);
+        Unflatten(row, *hist->GetLatErrorBand(row.band));
+      }
+      else
+      {
+        hist->AddVertErrorBand(row.band, row.nUniverses);
+        Unflatten(row, *hist->GetVertErrorBand(row.band));
+      }
+    }
+
+    tree->ResetBranchAddresses();
+    return hist;
+  }
+}
+
+namespace util
+{
+  bool CompactOutput()
+  {
+    return getenv("MNV101_COMPACT_OUTPUT") != nullptr;
+  }
+
+  void SetCompactCompression(TFile& file)
+  {
+    const char* setting = getenv("MNV101_COMPACT_OUTPUT");
+    if(!setting) return;
+
+    //ROOT's numbering for compression algorithms
+    const std::map<std::string, int> algorithms = {{"zlib", 1}, {"lzma", 2}, {"lz4", 4}, {"zstd", 5}};
+
+    const std::string choice = setting;
+    const size_t colon = choice.find(":");
+    const auto found = algorithms.find(choice.substr(0, colon));
+    if(found == algorithms.end()) return;
+
+    int level = 4;
+    if(colon != std::string::npos)
+    {
+      try { level = std::stoi(choice.substr(colon + 1)); }
+      catch(const std::exception& /*e*/) { return; }
+    }
+
+    file.SetCompressionSettings(found->second * 100 + std::min(std::max(level, 1), 9));
+  }
+
+  void WriteHist(const PlotUtils::MnvH1D& hist, TDirectory& dir, const std::string& name)
+  {
+    if(CompactOutput()) WriteCompact(hist, dir, name);
+    else dir.WriteTObject(&hist, name.c_str());
+  }
+
+  void WriteHist(const PlotUtils::MnvH2D& hist, TDirectory& dir, const std::string& name)
+  {
+    if(CompactOutput()) WriteCompact(hist, dir, name);
+    else dir.WriteTObject(&hist, name.c_str());
+  }
+
+  PlotUtils::MnvH1D* ReadCompact1D(TObject& obj, const std::vector<std::string>& bands)
+  {
+    return ReadCompact<PlotUtils::MnvH1D, TH1D>(obj, bands);
+  }
+
+  PlotUtils::MnvH2D* ReadCompact2D(TObject& obj, const std::vector<std::string>& bands)
+  {
+    return ReadCompact<PlotUtils::MnvH2D, TH2D>(obj, bands);
+  }
+}
@@ -0,0 +1,73 @@
+//File: CompactHist.h
+//Brief: An alternative to writing MnvH1Ds and MnvH2Ds with one TH1 per universe.
+//       A compact histogram is a TTree with the same name as the histogram and
+//       1 entry per error band.  Each entry holds every universe's bin contents and
+//       squared errors as one dense (universe x bin) array.  The CV with its
+//       binning and any pushed covariance matrices are in the TTree's UserInfo.
+//       Reading one back only reads the error bands asked for.
+//
+//       runEventLoop writes compact histograms when MNV101_COMPACT_OUTPUT is set.
+//       util::GetIngredient() turns them back into MnvH1Ds and MnvH2Ds automatically.
+
+#ifndef UTIL_COMPACTHIST_H
+#define UTIL_COMPACTHIST_H
+
+//c++ includes
+#include <string>
+#include <vector>
+
+class TObject;
+class TDirectory;
+class TFile;
+
+namespace PlotUtils
+{
+  class MnvH1D;
+  class MnvH2D;
+}
+
+namespace util
+{
+  //Title of every compact histogram's TTree so that readers can recognize them
+  constexpr const char* compactTitle = "util::CompactHist";
+
+  //Write hist to dir in the compact format as name.
+  //If !CompactOutput(), just writes hist as name instead.
+  void WriteHist(const PlotUtils::MnvH1D& hist, TDirectory& dir, const std::string& name);
+  void WriteHist(const PlotUtils::MnvH2D& hist, TDirectory& dir, const std::string& name);
+
+  //True if MNV101_COMPACT_OUTPUT is set
+  bool CompactOutput();
+
+  //Set file's compression from MNV101_COMPACT_OUTPUT.  It can be set to an algorithm
+  //name (zlib, lzma, lz4, or zstd) optionally followed by :<level>.  Anything else
+  //leaves ROOT's default compression alone.
+  void SetCompactCompression(TFile& file);
+
+  //Rebuild a histogram from obj if it's a compact histogram with the right
+  //dimension.  Returns nullptr otherwise.  Only reads the error bands in bands
+  //unless bands is empty.
+  PlotUtils::MnvH1D* ReadCompact1D(TObject& obj, const std::vector<std::string>& bands = {});
+  PlotUtils::MnvH2D* ReadCompact2D(TObject& obj, const std::vector<std::string>& bands = {});
+
+  //Hook for util::GetIngredient().  Builds TYPE from a compact histogram if it can.
+  template <class TYPE>
+  TYPE* FromCompact(TObject& /*obj*/)
+  {
+    return nullptr;
+  }
+
+  template <>
+  inline PlotUtils::MnvH1D* FromCompact<PlotUtils::MnvH1D>(TObject& obj)
+  {
+    return ReadCompact1D(obj);
+  }
+
+  template <>
+  inline PlotUtils::MnvH2D* FromCompact<PlotUtils::MnvH2D>(TObject& obj)
+  {
+    return ReadCompact2D(obj);
+  }
+}
+
+#endif //UTIL_COMPACTHIST_H
@@ -0,0 +1,172 @@
+//File: Covariance.cpp
+//Brief: Covariance and correlation matrices for a final result straight from a
+//       UniverseMatrix.  Each error band's covariance is an outer product of its
+//       universes' deviations accumulated in blocks of bins so that the inner loop
+//       is a contiguous multiply-add.  Matrices are indexed by global bin number
+//       including underflow and overflow like MnvH1D's.
+
+//Includes from this package
+#include "util/Covariance.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TDirectory.h"
+
+//c++ includes
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  //Bins per block.  A block of deviations from every universe plus a block of
+  //the covariance matrix fit in L1 cache for up to a few hundred universes.
+  constexpr int blockSize = 32;
+
+  //Report whether two covariance matrices agree to floating point precision
+  bool Agree(const TMatrixD& mine, const TMatrixD& theirs, const std::string& what)
+  {
+    if(mine.GetNrows() != theirs.GetNrows() || mine.GetNcols() != theirs.GetNcols())
+    {
+      std::cerr << "Covariance matrix for " << what << " is " << mine.GetNrows() << "x" << mine.GetNcols() << ", but MnvH1D's is " << theirs.GetNrows() << "x" << theirs.GetNcols() << ".\n";
+      return false;
+    }
+
+    const double tolerance = 1e-9 * std::sqrt(theirs.E2Norm());
+    for(int row = 0; row < mine.GetNrows(); ++row)
+    {
+      for(int col = 0; col < mine.GetNcols(); ++col)
+      {
+        if(std::fabs(mine(row, col) - theirs(row, col)) > tolerance)
+        {
+          std::cerr << "Covariance matrix for " << what << " disagrees with MnvH1D's at (" << row << ", " << col << "): " << mine(row, col) << " != " << theirs(row, col) << ".\n";
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
+
+namespace util
+{
+  TMatrixD Covariance(const UniverseMatrix& universes, const UniverseMatrix::Band& band)
+  {
+    const int nBins = universes.GetNBins(), nUnivs = band.nUniverses;
+
+    //Deviation of each universe from the center of the band, one contiguous row per universe
+    std::vector<double> center(universes.Content(0), universes.Content(0) + nBins);
+    if(band.useSpreadError)
+    {
+      std::fill(center.begin(), center.end(), 0.);
+      for(int whichUniv = 0; whichUniv < nUnivs; ++whichUniv)
+      {
+        const double* content = universes.Content(band.firstRow + whichUniv);
+        for(int whichBin = 0; whichBin < nBins; ++whichBin) center[whichBin] += content[whichBin] / nUnivs;
+      }
+    }
+
+    std::vector<double> deviations(nUnivs * nBins);
+    for(int whichUniv = 0; whichUniv < nUnivs; ++whichUniv)
+    {
+      const double* content = universes.Content(band.firstRow + whichUniv);
+      double* deviation = deviations.data() + whichUniv * nBins;
+      for(int whichBin = 0; whichBin < nBins; ++whichBin) deviation[whichBin] = content[whichBin] - center[whichBin];
+    }
+
+    //cov = deviations^T * deviations / nUnivs, one block of the upper triangle at a time
+    std::vector<double> cov(nBins * nBins, 0.);
+    for(int rowBlock = 0; rowBlock < nBins; rowBlock += blockSize)
+    {
+      const int rowEnd = std::min(rowBlock + blockSize, nBins);
+      for(int colBlock = rowBlock; colBlock < nBins; colBlock += blockSize)
+      {
+        const int colEnd = std::min(colBlock + blockSize, nBins);
+        for(int whichUniv = 0; whichUniv < nUnivs; ++whichUniv)
+        {
+          const double* deviation = deviations.data() + whichUniv * nBins;
+          for(int row = rowBlock; row < rowEnd; ++row)
+          {
+            const double rowDeviation = deviation[row];
+            double* covRow = cov.data() + row * nBins;
+            for(int col = colBlock; col < colEnd; ++col) covRow[col] += rowDeviation * deviation[col];
+          }
+        }
+      }
+    }
+
+    TMatrixD result(nBins, nBins);
+    for(int row = 0; row < nBins; ++row)
+    {
+      for(int col = row; col < nBins; ++col)
+      {
+        result(row, col) = cov[row * nBins + col] / nUnivs;
+        result(col, row) = result(row, col);
+      }
+    }
+
+    return result;
+  }
+
+  TMatrixD Correlation(const TMatrixD& cov)
+  {
+    TMatrixD corr(cov.GetNrows(), cov.GetNcols());
+    for(int row = 0; row < cov.GetNrows(); ++row)
+    {
+      for(int col = 0; col < cov.GetNcols(); ++col)
+      {
+        const double norm = std::sqrt(cov(row, row) * cov(col, col));
+        corr(row, col) = (norm > 0)?cov(row, col) / norm:0;
+      }
+    }
+
+    return corr;
+  }
+
+  bool WriteCovariances(const PlotUtils::MnvH1D& hist, const std::string& name, TDirectory& dir, const bool compareToMnvH1D)
+  {
+    const UniverseMatrix universes(hist);
+    const int nBins = universes.GetNBins();
+    bool agree = true;
+
+    //Statistical uncertainty is uncorrelated between bins
+    TMatrixD total(nBins, nBins);
+    for(int whichBin = 0; whichBin < nBins; ++whichBin) total(whichBin, whichBin) = universes.Err2(0)[whichBin];
+
+    for(const auto& band: universes.GetBands())
+    {
+      const auto cov = Covariance(universes, band);
+      dir.WriteObject(&cov, (name + "_covariance_" + band.name).c_str());
+      total += cov;
+
+      if(compareToMnvH1D) agree &= Agree(cov, hist.GetSysErrorMatrix(band.name), name + " error band " + band.name);
+    }
+
+    for(const auto& pushed: hist.GetSysErrorMatricesNames())
+    {
+      const auto cov = hist.GetSysErrorMatrix(pushed);
+      if(cov.GetNrows() != nBins || cov.GetNcols() != nBins)
+      {
+        std::cerr << "Skipping covariance matrix " << pushed << " for " << name << " because it doesn't have 1 row per bin.\n";
+        continue;
+      }
+      dir.WriteObject(&cov, (name + "_covariance_" + pushed).c_str());
+      total += cov;
+    }
+
+    dir.WriteObject(&total, (name + "_covariance_total").c_str());
+    const auto corr = Correlation(total);
+    dir.WriteObject(&corr, (name + "_correlation").c_str());
+
+    if(compareToMnvH1D) agree &= Agree(total, hist.GetTotalErrorMatrix(true), name + " total");
+
+    return agree;
+  }
+}
@@ -0,0 +1,40 @@
+//File: Covariance.h
+//Brief: Covariance and correlation matrices for a final result straight from a
+//       UniverseMatrix.  Each error band's covariance is an outer product of its
+//       universes' deviations accumulated in blocks of bins so that the inner loop
+//       is a contiguous multiply-add.  Matrices are indexed by global bin number
+//       including underflow and overflow like MnvH1D's.
+
+#ifndef UTIL_COVARIANCE_H
+#define UTIL_COVARIANCE_H
+
+//Includes from this package
+#include "util/UniverseMatrix.h"
+
+//ROOT includes
+#include "TMatrixD.h"
+
+//c++ includes
+#include <string>
+
+class TDirectory;
+
+namespace util
+{
+  //Covariance between bins from one error band's universes.  Deviations are from
+  //the CV unless band.useSpreadError, in which case they're from the universes' mean.
+  TMatrixD Covariance(const UniverseMatrix& universes, const UniverseMatrix::Band& band);
+
+  //Correlation matrix from a covariance matrix.  Bins with no variance have no correlation.
+  TMatrixD Correlation(const TMatrixD& cov);
+
+  //Write each error band's covariance matrix, the total covariance matrix, and the total
+  //correlation matrix for hist to dir as <name>_covariance_<band>, <name>_covariance_total,
+  //and <name>_correlation.  The total includes statistical uncertainty and covariance
+  //matrices pushed with MnvH1D::PushCovMatrix().  If compareToMnvH1D, also compare
+  //with hist's own covariance matrices and complain to std::cerr about disagreements.
+  //Returns false if compareToMnvH1D found a disagreement.
+  bool WriteCovariances(const PlotUtils::MnvH1D& hist, const std::string& name, TDirectory& dir, const bool compareToMnvH1D = false);
+}
+
+#endif //UTIL_COVARIANCE_H
@@ -0,0 +1,189 @@
+//File: CrossSectionSteps.cpp
+//Brief: The cross section extraction steps that act on every universe the same way.
+//       Each one is a single pass over UniverseMatrix rows that does the work of a
+//       chain of MnvH1D::Add(), Divide(), and Scale() calls without making a new
+//       MnvH1D for every step.  Errors propagate like those functions do: every
+//       input is treated as uncorrelated with every other input.
+
+//Includes from this package
+#include "util/CrossSectionSteps.h"
+#include "util/UniverseMatrix.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TMatrixD.h"
+
+//c++ includes
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+  void CheckLayout(const util::UniverseMatrix& lhs, const util::UniverseMatrix& rhs)
+  {
+    if(lhs.GetNRows() != rhs.GetNRows() || lhs.GetNBins() != rhs.GetNBins()) throw std::runtime_error("Universe matrices for cross section extraction have different shapes.");
+  }
+
+  //TH1::Divide() without the binomial option.  Bins where den is 0 are set to 0.
+  inline void Divide(const double num, const double numErr2, const double den, const double denErr2, double& quotient, double& quotientErr2)
+  {
+    const double den2 = den * den;
+    const bool valid = (den != 0);
+    quotient = valid?num / den:0;
+    quotientErr2 = valid?(numErr2 * den2 + denErr2 * num * num) / (den2 * den2):0;
+  }
+}
+
+namespace util
+{
+  void SubtractBackgrounds(UniverseMatrix& folded, const std::vector<const UniverseMatrix*>& backgrounds, const double scale)
+  {
+    for(const auto background: backgrounds) CheckLayout(folded, *background);
+
+    const int nBins = folded.GetNBins();
+    const double scale2 = scale * scale;
+    for(int row = 0; row < folded.GetNRows(); ++row)
+    {
+      double* content = folded.Content(row);
+      double* err2 = folded.Err2(row);
+      for(const auto background: backgrounds)
+      {
+        const double* bkgContent = background->Content(row);
+        const double* bkgErr2 = background->Err2(row);
+        for(int whichBin = 0; whichBin < nBins; ++whichBin)
+        {
+          content[whichBin] -= scale * bkgContent[whichBin];
+          err2[whichBin] += scale2 * bkgErr2[whichBin];
+        }
+      }
+    }
+  }
+
+  std::vector<double> SidebandBackgroundScales(const UniverseMatrix& data, const UniverseMatrix& signal,
+                                               const std::vector<const UniverseMatrix*>& backgrounds, const double scale)
+  {
+    CheckLayout(data, signal);
+    for(const auto background: backgrounds) CheckLayout(data, *background);
+
+    const int nBins = data.GetNBins();
+    std::vector<double> factors(data.GetNRows(), 1);
+    for(int row = 0; row < data.GetNRows(); ++row)
+    {
+      double dataSum = 0, bkgSum = 0;
+      const double* dataContent = data.Content(row);
+      const double* signalContent = signal.Content(row);
+      for(int whichBin = 1; whichBin < nBins - 1; ++whichBin) dataSum += dataContent[whichBin] - scale * signalContent[whichBin];
+
+      for(const auto background: backgrounds)
+      {
+        const double* bkgContent = background->Content(row);
+        for(int whichBin = 1; whichBin < nBins - 1; ++whichBin) bkgSum += scale * bkgContent[whichBin];
+      }
+
+      if(bkgSum != 0) factors[row] = dataSum / bkgSum;
+    }
+
+    return factors;
+  }
+
+  void ScaleUniverses(UniverseMatrix& hist, const std::vector<double>& factors)
+  {
+    if(static_cast<int>(factors.size()) != hist.GetNRows()) throw std::runtime_error("Got a different number of factors than universes to scale.");
+
+    const int nBins = hist.GetNBins();
+    for(int row = 0; row < hist.GetNRows(); ++row)
+    {
+      double* content = hist.Content(row);
+      double* err2 = hist.Err2(row);
+      const double factor2 = factors[row] * factors[row];
+      for(int whichBin = 0; whichBin < nBins; ++whichBin)
+      {
+        content[whichBin] *= factors[row];
+        err2[whichBin] *= factor2;
+      }
+    }
+  }
+
+  std::vector<double> EfficiencyCorrectAndNormalize(UniverseMatrix& unfolded, const UniverseMatrix* effNum, const UniverseMatrix* effDenom,
+                                                    const UniverseMatrix& flux, const std::vector<double>& binWidths,
+                                                    const double nNucleons, const double POT,
+                                                    UniverseMatrix* efficiency, UniverseMatrix* efficiencyCorrected)
+  {
+    CheckLayout(unfolded, flux);
+    if(effNum)
+    {
+      if(!effDenom) throw std::runtime_error("Efficiency correction needs both a numerator and a denominator.");
+      CheckLayout(unfolded, *effNum);
+      CheckLayout(unfolded, *effDenom);
+    }
+    if(efficiency) CheckLayout(unfolded, *efficiency);
+    if(efficiencyCorrected) CheckLayout(unfolded, *efficiencyCorrected);
+
+    const int nBins = unfolded.GetNBins();
+    if(static_cast<int>(binWidths.size()) != nBins) throw std::runtime_error("Got a different number of bin widths than bins for cross section normalization.");
+
+    //Flux histogram is in m^-2, but convention is to report cm^2
+    std::vector<double> norm(nBins), norm2(nBins);
+    for(int whichBin = 0; whichBin < nBins; ++whichBin)
+    {
+      norm[whichBin] = 1.e4 / nNucleons / POT / binWidths[whichBin];
+      norm2[whichBin] = norm[whichBin] * norm[whichBin];
+    }
+
+    std::vector<double> cvFactors(nBins);
+    for(int row = 0; row < unfolded.GetNRows(); ++row)
+    {
+      double* content = unfolded.Content(row);
+      double* err2 = unfolded.Err2(row);
+      const double* fluxContent = flux.Content(row);
+      const double* fluxErr2 = flux.Err2(row);
+
+      for(int whichBin = 0; whichBin < nBins; ++whichBin)
+      {
+        double eff = 1, effErr2 = 0;
+        if(effNum)
+        {
+          Divide(effNum->Content(row)[whichBin], effNum->Err2(row)[whichBin], effDenom->Content(row)[whichBin], effDenom->Err2(row)[whichBin], eff, effErr2);
+          if(efficiency)
+          {
+            efficiency->Content(row)[whichBin] = eff;
+            efficiency->Err2(row)[whichBin] = effErr2;
+          }
+          Divide(content[whichBin], err2[whichBin], eff, effErr2, content[whichBin], err2[whichBin]);
+        }
+        if(efficiencyCorrected)
+        {
+          efficiencyCorrected->Content(row)[whichBin] = content[whichBin];
+          efficiencyCorrected->Err2(row)[whichBin] = err2[whichBin];
+        }
+
+        Divide(content[whichBin], err2[whichBin], fluxContent[whichBin], fluxErr2[whichBin], content[whichBin], err2[whichBin]);
+        content[whichBin] *= norm[whichBin];
+        err2[whichBin] *= norm2[whichBin];
+
+        if(row == 0) cvFactors[whichBin] = (eff != 0 && fluxContent[whichBin] != 0)?norm[whichBin] / eff / fluxContent[whichBin]:0;
+      }
+    }
+
+    return cvFactors;
+  }
+
+  void PushScaledCovMatrices(const PlotUtils::MnvH1D& from, PlotUtils::MnvH1D& to, const std::vector<double>& factors)
+  {
+    for(const auto& name: from.GetSysErrorMatricesNames())
+    {
+      TMatrixD cov = from.GetSysErrorMatrix(name);
+      const int nBins = std::min<int>(cov.GetNrows(), factors.size());
+      for(int row = 0; row < nBins; ++row)
+      {
+        for(int col = 0; col < nBins; ++col) cov(row, col) *= factors[row] * factors[col];
+      }
+      to.PushCovMatrix(name, cov);
+    }
+  }
+}
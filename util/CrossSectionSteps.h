@@ -0,0 +1,53 @@
+//File: CrossSectionSteps.h
+//Brief: The cross section extraction steps that act on every universe the same way.
+//       Each one is a single pass over UniverseMatrix rows that does the work of a
+//       chain of MnvH1D::Add(), Divide(), and Scale() calls without making a new
+//       MnvH1D for every step.  Errors propagate like those functions do: every
+//       input is treated as uncorrelated with every other input.
+
+#ifndef UTIL_CROSSSECTIONSTEPS_H
+#define UTIL_CROSSSECTIONSTEPS_H
+
+//c++ includes
+#include <vector>
+
+namespace PlotUtils
+{
+  class MnvH1D;
+}
+
+namespace util
+{
+  class UniverseMatrix;
+
+  //folded - scale * (sum of backgrounds), in place.  Every background must have folded's layout.
+  void SubtractBackgrounds(UniverseMatrix& folded, const std::vector<const UniverseMatrix*>& backgrounds, const double scale);
+
+  //Factor for each universe that makes scale * (sum of backgrounds) match
+  //data - scale * signal in a sideband, summed over every bin but underflow and
+  //overflow.  Universes without any background get 1.  Every matrix must have
+  //data's layout.
+  std::vector<double> SidebandBackgroundScales(const UniverseMatrix& data, const UniverseMatrix& signal,
+                                               const std::vector<const UniverseMatrix*>& backgrounds, const double scale);
+
+  //Multiply each universe of hist by its own factor, in place
+  void ScaleUniverses(UniverseMatrix& hist, const std::vector<double>& factors);
+
+  //Everything after unfolding in place on unfolded:
+  //unfolded / (effNum / effDenom) / flux * 1e4 / nNucleons / POT / bin width
+  //Leave effNum as nullptr to skip efficiency correction, like for the simulated
+  //cross section.  If efficiency or efficiencyCorrected aren't nullptr, they get
+  //the intermediate results for plotting.  Every matrix must have unfolded's layout.
+  //binWidths is the width of each global bin.  Returns the factor each bin of
+  //the CV was multiplied by to transform covariance matrices.
+  std::vector<double> EfficiencyCorrectAndNormalize(UniverseMatrix& unfolded, const UniverseMatrix* effNum, const UniverseMatrix* effDenom,
+                                                    const UniverseMatrix& flux, const std::vector<double>& binWidths,
+                                                    const double nNucleons, const double POT,
+                                                    UniverseMatrix* efficiency = nullptr, UniverseMatrix* efficiencyCorrected = nullptr);
+
+  //Push every covariance matrix from "from" onto "to" with bin i, j multiplied
+  //by factors[i] * factors[j].
+  void PushScaledCovMatrices(const PlotUtils::MnvH1D& from, PlotUtils::MnvH1D& to, const std::vector<double>& factors);
+}
+
+#endif //UTIL_CROSSSECTIONSTEPS_H
@@ -0,0 +1,188 @@
+//File: EventSelectionEntry.h
+//Brief: What runEventLoop's MC reco loop does with each entry: the CV's Model
+//       weight, then every universe's cuts, weight, and fills for every
+//       AnalysisConfig.  Everything that needs memory is looked up when an
+//       EventSelectionEntry is made, so Fill() doesn't allocate.
+//       test/AllocationsPerEntry checks that with a stub Model.
+
+#ifndef UTIL_EVENTSELECTIONENTRY_H
+#define UTIL_EVENTSELECTIONENTRY_H
+
+//Includes from this package
+#include "event/CVUniverse.h"
+#include "event/MichelEvent.h"
+#include "util/AnalysisConfig.h"
+#include "util/UniverseTable.h"
+#include "util/EventStore.h"
+#include "util/PerfCounters.h"
+#include "studies/Study.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/Model.h"
+#pragma GCC diagnostic pop
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <bitset>
+#include <cassert>
+
+class EventSelectionEntry
+{
+  public:
+    //configs and model must outlive this object.  store and perf may be nullptr.
+    EventSelectionEntry(const std::map<std::string, std::vector<CVUniverse*>>& errorBands, const std::vector<AnalysisConfig*>& configs,
+                        PlotUtils::Model<CVUniverse, MichelEvent>& model, util::EventStore* store, util::PerfCounters* perf):
+      fConfigs(configs), fStudiesByBand(studiesByBand(configs, errorBands)), fModel(model), fStore(store), fPerf(perf),
+      fCVPerf(perf?&perf->GetRow("cv"):nullptr), fTable(errorBands, fStudiesByBand, perf), fCV(nullptr)
+    {
+      const auto cv = errorBands.find("cv");
+      assert(cv != errorBands.end() && !cv->second.empty() && "\"cv\" error band is empty!  Can't set Model weight.");
+      fCV = cv->second.front();
+
+      for(const auto config: configs) fLoopVars.push_back(config->LoopVars());
+    }
+
+    EventSelectionEntry(const EventSelectionEntry&) = delete; //fTable can't be copied
+
+    //Fill every AnalysisConfig with entry in every universe.  Move the CV
+    //universe to entry first.  The other universes are moved here.
+    void Fill(const Long64_t entry)
+    {
+      using perfScope = util::PerfCounters::Scope;
+
+      fCVEvent.Reset();
+      double cvWeight = 0;
+      {
+        perfScope scope(fPerf, fCVPerf, util::PerfCounters::weight);
+        fModel.SetEntry(*fCV, fCVEvent);
+        cvWeight = fModel.GetWeight(*fCV, fCVEvent);
+      }
+      if(fStore) fStore->BeginEntry(entry);
+
+      //=========================================
+      // Systematics loop(s)
+      //=========================================
+      for (const auto& slot: fTable.universes)
+      {
+        CVUniverse* universe = slot.universe;
+        util::PerfCounters::Row* bandPerf = slot.band->perf;
+        // Tell the Event which entry in the TChain it's looking at
+        {
+          perfScope scope(fPerf, bandPerf, util::PerfCounters::setEntry);
+          universe->SetEntry(entry);
+        }
+
+        //Every configuration shares the same weight.  Only calculate it once and only if some configuration uses it.
+        double weight = 0;
+        bool haveWeight = false;
+        for(size_t whichConfig = 0; whichConfig < fConfigs.size(); ++whichConfig)
+        {
+          auto& michelcuts = *fConfigs[whichConfig]->cuts;
+          const auto& vars = fLoopVars[whichConfig];
+          const auto& vars2D = fConfigs[whichConfig]->vars2D;
+          const bool isNominal = (whichConfig == 0);
+
+          fEvent.Reset(); // make sure your event is reset inside the error band loop.
+
+          // This is where you would Access/create a Michel
+
+          //weight is ignored in isMCSelected() for all but the CV Universe.
+          //Sidebands reuse the same cut results as the signal region.
+          std::bitset<64> selected;
+          bool isSignal = false;
+          {
+            perfScope scope(fPerf, bandPerf, util::PerfCounters::cuts);
+            selected = michelcuts.isMCSelected(*universe, fEvent, cvWeight);
+          }
+          const int whichSideband = fConfigs[whichConfig]->WhichSideband(selected);
+          if (!selected.all() && whichSideband < 0) continue;
+          if(!haveWeight) //Only calculate the per-universe weight for events that will actually use it.
+          {
+            perfScope scope(fPerf, bandPerf, util::PerfCounters::weight);
+            weight = fModel.GetWeight(*universe, fEvent);
+          }
+          haveWeight = true;
+
+          {
+            perfScope scope(fPerf, bandPerf, util::PerfCounters::cuts);
+            isSignal = michelcuts.isSignal(*universe, weight);
+          }
+          perfScope fillScope(fPerf, bandPerf, util::PerfCounters::fill);
+
+          if(whichSideband >= 0)
+          {
+            for(auto& var: fConfigs[whichConfig]->vars)
+            {
+              auto& sideband = var->m_sidebands[whichSideband];
+              if(isSignal) sideband.selectedSignalReco->FillUniverse(universe, var->GetRecoValue(*universe), weight);
+              else (*sideband.backgrounds)[(universe->GetCurrent() == 2)?0:1].FillUniverse(universe, var->GetRecoValue(*universe), weight);
+            }
+            continue;
+          }
+
+          for(auto& var: vars) var->selectedMCReco->FillUniverse(universe, var->GetRecoValue(*universe), weight); //"Fake data" for closure
+
+          if(isSignal)
+          {
+            if(fStore && isNominal) fStore->FillSelected(*universe, util::eventStore::signal, weight);
+            for(auto& study: *slot.band->studies[whichConfig]) study->SelectedSignal(*universe, fEvent, weight);
+
+            for(auto& var: vars)
+            {
+              //Cross section components
+              var->efficiencyNumerator->FillUniverse(universe, var->GetTrueValue(*universe), weight);
+              var->migration->FillUniverse(universe, var->GetRecoValue(*universe), var->GetTrueValue(*universe), weight);
+              var->selectedSignalReco->FillUniverse(universe, var->GetRecoValue(*universe), weight); //Efficiency numerator in reco variables.  Useful for warping studies.
+            }
+
+            for(auto& var: vars2D)
+            {
+              var->efficiencyNumerator->FillUniverse(universe, var->GetTrueValueX(*universe), var->GetTrueValueY(*universe), weight);
+            }
+          }
+          else
+          {
+            int bkgd_ID = -1;
+            if (universe->GetCurrent()==2)bkgd_ID=0;
+            else bkgd_ID=1;
+
+            if(fStore && isNominal) fStore->FillSelected(*universe, bkgd_ID, weight);
+            for(auto& var: vars) (*var->m_backgroundHists)[bkgd_ID].FillUniverse(universe, var->GetRecoValue(*universe), weight);
+            if(universe == fCV)
+            {
+              for(auto& var: vars) (*var->m_backgroundsByGENIELabel)(bkgd_ID, universe->GetInteractionType()).FillUniverse(universe, var->GetRecoValue(*universe), weight);
+            }
+            for(auto& var: vars2D) (*var->m_backgroundHists)[bkgd_ID].FillUniverse(universe, var->GetRecoValueX(*universe), var->GetRecoValueY(*universe), weight);
+          }
+        } // End configuration loop
+      } // End universe loop
+      if(fStore) fStore->EndEntry();
+    }
+
+  private:
+    std::vector<AnalysisConfig*> fConfigs;
+    std::vector<std::vector<Variable*>> fLoopVars; //Each AnalysisConfig's LoopVars()
+    std::vector<std::map<std::string, std::vector<Study*>>> fStudiesByBand; //fTable points into this
+    PlotUtils::Model<CVUniverse, MichelEvent>& fModel;
+    util::EventStore* fStore;
+    util::PerfCounters* fPerf;
+    util::PerfCounters::Row* fCVPerf;
+    UniverseTable fTable;
+    CVUniverse* fCV;
+    MichelEvent fCVEvent, fEvent; //Reused for every entry
+
+    //Only call each Study for the bands it needs
+    static std::vector<std::map<std::string, std::vector<Study*>>> studiesByBand(const std::vector<AnalysisConfig*>& configs,
+                                                                               const std::map<std::string, std::vector<CVUniverse*>>& errorBands)
+    {
+      std::vector<std::map<std::string, std::vector<Study*>>> byConfig;
+      for(const auto config: configs) byConfig.push_back(StudiesByBand(config->studies, errorBands));
+      return byConfig;
+    }
+};
+
+#endif //UTIL_EVENTSELECTIONENTRY_H
@@ -0,0 +1,204 @@
+//File: EventStore.cpp
+//Brief: An EventStore records which universes selected each AnaTuple entry along
+//       with every Variable's reco and true values and the Model weight in that
+//       universe.  runEventLoop writes one when MNV101_EVENT_STORE is set, and
+//       HistogramSelectedEvents turns it back into the histograms that
+//       ExtractCrossSection expects.
+
+//Includes from this package
+#include "util/EventStore.h"
+#include "util/Variable.h"
+#include "event/CVUniverse.h"
+
+//ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+#include "TParameter.h"
+#include "TNamed.h"
+
+//c++ includes
+#include <stdexcept>
+
+namespace util
+{
+  EventStore::EventStore(const std::string& fileName, const std::vector<Variable*>& vars,
+                         const std::map<std::string, std::vector<CVUniverse*>>& recoBands,
+                         const std::map<std::string, std::vector<CVUniverse*>>& truthBands): fFile(TFile::Open(fileName.c_str(), "RECREATE")),
+                                                                                             fCurrentTree(nullptr), fVars(vars), fEntry(-1),
+                                                                                             fUniverse(nullptr), fWeight(nullptr), fCategory(nullptr),
+                                                                                             fKinematicsIndex(nullptr), fKinematics(nullptr), fVerticalSet(-1)
+  {
+    if(!fFile) throw std::runtime_error("Failed to create an event store named " + fileName);
+    fFile->cd();
+
+    //Give each universe an index.  The nth universe in a reco band gets the same
+    //index as the nth universe in the truth band with the same name.
+    std::string band;
+    int whichUniverse = 0;
+    bool isLateral = false;
+    TTree universes(eventStore::universeTree, "Band and position of each universe index");
+    universes.Branch("band", &band);
+    universes.Branch("whichUniverse", &whichUniverse);
+    universes.Branch("isLateral", &isLateral);
+
+    int nextIndex = 0;
+    for(const auto& recoBand: recoBands)
+    {
+      const auto truthBand = truthBands.find(recoBand.first);
+      if(truthBand == truthBands.end() || truthBand->second.size() != recoBand.second.size())
+      {
+        throw std::runtime_error("Reco and truth error bands don't match for band " + recoBand.first);
+      }
+
+      for(size_t whichUniv = 0; whichUniv < recoBand.second.size(); ++whichUniv)
+      {
+        fUnivToIndex[recoBand.second[whichUniv]] = nextIndex;
+        fUnivToIndex[truthBand->second[whichUniv]] = nextIndex;
+
+        band = recoBand.first;
+        whichUniverse = whichUniv;
+        isLateral = !recoBand.second[whichUniv]->IsVerticalOnly();
+        universes.Fill();
+        ++nextIndex;
+      }
+    }
+    universes.Write();
+
+    //Just enough to set up new Variables in HistogramSelectedEvents
+    std::string name, title;
+    std::vector<double> bins, *binsPtr = &bins;
+    TTree variables(eventStore::variableTree, "Variables stored in each set of kinematics");
+    variables.Branch("name", &name);
+    variables.Branch("title", &title);
+    variables.Branch("bins", "std::vector<double>", &binsPtr);
+    for(const auto var: fVars)
+    {
+      name = var->GetName();
+      title = var->GetAxisLabel();
+      bins = var->GetBinVec();
+      variables.Fill();
+    }
+    variables.Write();
+
+    //Kinematics are stored as one set of nVars reco values followed by nVars true values
+    //for Selected.  EffDenom only has the true values, and Data only has reco values.
+    fSelected = new TTree(eventStore::selectedTree, "Selected MC entries");
+    fEffDenom = new TTree(eventStore::effDenomTree, "Efficiency denominator entries");
+    fData = new TTree(eventStore::dataTree, "Selected data entries");
+
+    //Allocated only after everything that can throw so that they never leak
+    fUniverse = new std::vector<int>;
+    fWeight = new std::vector<double>;
+    fCategory = new std::vector<int>;
+    fKinematicsIndex = new std::vector<int>;
+    fKinematics = new std::vector<double>;
+
+    for(auto tree: {fSelected, fEffDenom, fData})
+    {
+      tree->Branch("entry", &fEntry);
+      tree->Branch("kinematics", "std::vector<double>", &fKinematics);
+    }
+
+    for(auto tree: {fSelected, fEffDenom})
+    {
+      tree->Branch("universe", "std::vector<int>", &fUniverse);
+      tree->Branch("weight", "std::vector<double>", &fWeight);
+      tree->Branch("kinematicsIndex", "std::vector<int>", &fKinematicsIndex);
+    }
+    fSelected->Branch("category", "std::vector<int>", &fCategory);
+  }
+
+  EventStore::~EventStore()
+  {
+    //Also deletes the trees
+    if(fFile) fFile->Close();
+    fFile.reset();
+
+    delete fUniverse;
+    delete fWeight;
+    delete fCategory;
+    delete fKinematicsIndex;
+    delete fKinematics;
+  }
+
+  void EventStore::BeginEntry(const Long64_t entry)
+  {
+    fEntry = entry;
+    fCurrentTree = nullptr;
+    fVerticalSet = -1;
+
+    fUniverse->clear();
+    fWeight->clear();
+    fCategory->clear();
+    fKinematicsIndex->clear();
+    fKinematics->clear();
+  }
+
+  void EventStore::EndEntry()
+  {
+    if(fCurrentTree) fCurrentTree->Fill();
+  }
+
+  void EventStore::FillSelected(const CVUniverse& univ, const int category, const double weight)
+  {
+    fCurrentTree = fSelected;
+    fUniverse->push_back(fUnivToIndex.at(&univ));
+    fWeight->push_back(weight);
+    fCategory->push_back(category);
+    fKinematicsIndex->push_back(kinematicsFor(univ, true, true));
+  }
+
+  void EventStore::FillEffDenom(const CVUniverse& univ, const double weight)
+  {
+    fCurrentTree = fEffDenom;
+    fUniverse->push_back(fUnivToIndex.at(&univ));
+    fWeight->push_back(weight);
+    fKinematicsIndex->push_back(kinematicsFor(univ, false, true));
+  }
+
+  void EventStore::FillData(const CVUniverse& univ, const int michelIdx)
+  {
+    fCurrentTree = fData;
+    addKinematics(univ, true, false, michelIdx);
+  }
+
+  void EventStore::Write(const double mcPOT, const double dataPOT, const double nNucleons)
+  {
+    fFile->cd();
+    fSelected->Write();
+    fEffDenom->Write();
+    fData->Write();
+
+    TParameter<double>("MCPOTUsed", mcPOT).Write();
+    TParameter<double>("DataPOTUsed", dataPOT).Write();
+    TParameter<double>("fiducial_nucleons", nNucleons).Write();
+
+    //Flux configuration for the flux integral
+    TNamed("playlist", CVUniverse::GetPlaylist().c_str()).Write();
+    TParameter<int>("AnalysisNuPDG", CVUniverse::GetAnalysisNuPDG()).Write();
+    TParameter<bool>("NuEConstraint", CVUniverse::UseNuEConstraint()).Write();
+    TParameter<int>("NFluxUniverses", CVUniverse::GetNFluxUniverses()).Write();
+
+    fFile->Close();
+    fFile.reset();
+  }
+
+  int EventStore::addKinematics(const CVUniverse& univ, const bool reco, const bool truth, const int michelIdx)
+  {
+    const size_t setSize = fVars.size() * (reco + truth);
+    const int whichSet = fKinematics->size() / setSize;
+
+    if(reco) for(const auto var: fVars) fKinematics->push_back(var->GetRecoValue(univ, michelIdx));
+    if(truth) for(const auto var: fVars) fKinematics->push_back(var->GetTrueValue(univ));
+
+    return whichSet;
+  }
+
+  int EventStore::kinematicsFor(const CVUniverse& univ, const bool reco, const bool truth)
+  {
+    if(!univ.IsVerticalOnly()) return addKinematics(univ, reco, truth);
+
+    if(fVerticalSet < 0) fVerticalSet = addKinematics(univ, reco, truth);
+    return fVerticalSet;
+  }
+}
@@ -0,0 +1,96 @@
+//File: EventStore.h
+//Brief: An EventStore records which universes selected each AnaTuple entry along
+//       with every Variable's reco and true values and the Model weight in that
+//       universe.  runEventLoop writes one when MNV101_EVENT_STORE is set, and
+//       HistogramSelectedEvents turns it back into the histograms that
+//       ExtractCrossSection expects.  Rebinning studies only need to rerun the
+//       second step.
+//
+//       Each entry is one row in a TTree.  Vertical-only universes can't change
+//       a Variable's value, so they all share one set of kinematics per row.
+//       Only the CV and lateral universes pay for their own values.
+
+#ifndef UTIL_EVENTSTORE_H
+#define UTIL_EVENTSTORE_H
+
+//ROOT includes
+#include "Rtypes.h"
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+
+class CVUniverse;
+class Variable;
+class TFile;
+class TTree;
+
+namespace util
+{
+  //Names of objects in an EventStore file.  Shared by the writer and HistogramSelectedEvents.
+  namespace eventStore
+  {
+    constexpr const char* selectedTree = "Selected";
+    constexpr const char* effDenomTree = "EffDenom";
+    constexpr const char* dataTree = "Data";
+    constexpr const char* universeTree = "Universes";
+    constexpr const char* variableTree = "Variables";
+
+    //category branch value for signal events.  Anything else is a background ID.
+    constexpr int signal = -1;
+  }
+
+  class EventStore
+  {
+    public:
+      //recoBands and truthBands must have the same band names and numbers of universes.
+      //They will, as long as they were both made by the same function.
+      EventStore(const std::string& fileName, const std::vector<Variable*>& vars,
+                 const std::map<std::string, std::vector<CVUniverse*>>& recoBands,
+                 const std::map<std::string, std::vector<CVUniverse*>>& truthBands);
+      ~EventStore();
+
+      //Call BeginEntry() before filling any universe for an AnaTuple entry
+      //and EndEntry() once all universes are done.
+      void BeginEntry(const Long64_t entry);
+      void EndEntry();
+
+      void FillSelected(const CVUniverse& univ, const int category, const double weight);
+      void FillEffDenom(const CVUniverse& univ, const double weight);
+      void FillData(const CVUniverse& univ, const int michelIdx);
+
+      //Save the trees and everything else HistogramSelectedEvents needs to
+      //reproduce runEventLoop's output files.  Closes the file.  If an event
+      //loop fails before Write(), the destructor closes the file without it.
+      void Write(const double mcPOT, const double dataPOT, const double nNucleons);
+
+    private:
+      std::unique_ptr<TFile> fFile; //Owns fSelected, fEffDenom, and fData
+      TTree* fSelected;
+      TTree* fEffDenom;
+      TTree* fData;
+      TTree* fCurrentTree; //Which tree this entry belongs to, or nullptr if nothing passed
+
+      std::vector<Variable*> fVars;
+      std::unordered_map<const CVUniverse*, int> fUnivToIndex;
+
+      //Branch buffers
+      Long64_t fEntry;
+      std::vector<int>* fUniverse;
+      std::vector<double>* fWeight;
+      std::vector<int>* fCategory;
+      std::vector<int>* fKinematicsIndex;
+      std::vector<double>* fKinematics;
+
+      int fVerticalSet; //Index of the kinematics shared by vertical-only universes for this entry
+
+      //Append each Variable's reco and/or true value to fKinematics and return the index of this set
+      int addKinematics(const CVUniverse& univ, const bool reco, const bool truth, const int michelIdx = -1);
+      int kinematicsFor(const CVUniverse& univ, const bool reco, const bool truth);
+  };
+}
+
+#endif //UTIL_EVENTSTORE_H
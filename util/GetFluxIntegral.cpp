@@ -1,6 +1,12 @@
 //File: GetFluxIntegral.cpp
 //Brief: Provides the integrated flux needed at the end of a differential cross section extraction.
 //       Matches the binning of an input histogram.
+//
+//       If MNV101_FLUX_CACHE is set to a directory, each integral is saved there
+//       in a file named after a hash of everything it depends on.  Later calls
+//       with the same inputs read that file instead of loading the flux reweighter.
+//       The flux files' sizes and modification times are part of that hash, so
+//       updating them in place invalidates the cache.
 //Author: Andrew Olivier aolivier@ur.rochester.edu
 
 //Includes from this package
@@ -11,21 +17,159 @@
 #include "PlotUtils/MnvH1D.h"
 #include "PlotUtils/FluxReweighter.h"
 
-class CVUniverse;
+//ROOT includes
+#include "TFile.h"
+#include "TNamed.h"
 
-namespace PlotUtils
+//c++ includes
+#include <cstdlib>
+#include <cstdio> //std::rename()
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+//POSIX includes
+#include <unistd.h> //getpid()
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace
 {
-  class MnvH1D;
+  //Bump this when the way integrals are calculated changes to ignore old cache files
+  constexpr int cacheVersion = 2;
+
+  //Directories under MPARAMFILESROOT that the flux reweighter reads from
+  const std::vector<std::string> fluxDirs = {"data/Flux", "data/FluxConstraints"};
+
+  //Add path and size and modification time of every file under dirName to key in
+  //a consistent order.  Skips anything that can't be read.  The flux reweighter will
+  //complain about those if it needs them.
+  void AddFileIdentities(const std::string& dirName, std::stringstream& key)
+  {
+    DIR* dir = opendir(dirName.c_str());
+    if(!dir) return;
+
+    std::vector<std::string> entries;
+    for(dirent* entry = readdir(dir); entry; entry = readdir(dir))
+    {
+      const std::string name = entry->d_name;
+      if(name != "." && name != "..") entries.push_back(name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+
+    for(const auto& name: entries)
+    {
+      const std::string path = dirName + "/" + name;
+      struct stat info;
+      if(stat(path.c_str(), &info) != 0) continue;
+
+      if(S_ISDIR(info.st_mode)) AddFileIdentities(path, key);
+      else key << path << ":" << info.st_size << ":" << info.st_mtime << ",";
+    }
+  }
+
+  //Everything GetIntegratedFluxReweighted() depends on as one string
+  std::string CacheKey(const std::string& playlist, const int nuPDG, const bool useNuEConstraint, const int nFluxUniverses,
+                       const bool useMuonCorrelations, const PlotUtils::MnvH1D& templateHist, const double Emin, const double Emax)
+  {
+    std::stringstream key;
+    key << std::setprecision(17) << "version=" << cacheVersion << ";playlist=" << playlist << ";nuPDG=" << nuPDG
+        << ";nuEConstraint=" << useNuEConstraint << ";nFluxUniverses=" << nFluxUniverses
+        << ";muonCorrelations=" << useMuonCorrelations << ";Emin=" << Emin << ";Emax=" << Emax;
+
+    //The flux files themselves
+    const char* fluxFiles = getenv("MPARAMFILESROOT");
+    key << ";MPARAMFILESROOT=" << (fluxFiles?fluxFiles:"") << ";fluxFiles=";
+    if(fluxFiles)
+    {
+      for(const auto& dir: fluxDirs) AddFileIdentities(std::string(fluxFiles) + "/" + dir, key);
+    }
+
+    key << ";bins=";
+    const auto axis = templateHist.GetXaxis();
+    for(int whichEdge = 1; whichEdge <= axis->GetNbins() + 1; ++whichEdge) key << axis->GetBinLowEdge(whichEdge) << ",";
+
+    key << ";bands=";
+    for(const auto& band: templateHist.GetVertErrorBandNames()) key << band << ":" << templateHist.GetVertErrorBand(band)->GetNHists() << ",";
+    return key.str();
+  }
+
+  //64-bit FNV-1a
+  std::string Hash(const std::string& key)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for(const unsigned char c: key)
+    {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+
+    std::stringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return hex.str();
+  }
+
+  //nullptr unless fileName has an integral with exactly key
+  PlotUtils::MnvH1D* ReadCached(const std::string& fileName, const std::string& key)
+  {
+    if(access(fileName.c_str(), R_OK) != 0) return nullptr;
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+    if(!file) return nullptr;
+
+    const auto cachedKey = dynamic_cast<TNamed*>(file->Get("key"));
+    if(!cachedKey || key != cachedKey->GetTitle()) return nullptr; //Hash collision
+
+    auto integral = dynamic_cast<PlotUtils::MnvH1D*>(file->Get("fluxIntegral"));
+    if(integral) integral->SetDirectory(nullptr);
+    return integral;
+  }
+
+  //Write to a temporary file and rename it so that jobs sharing the cache never read half of a file
+  void WriteCached(const std::string& fileName, const std::string& key, const PlotUtils::MnvH1D& integral)
+  {
+    const std::string tempName = fileName + ".tmp" + std::to_string(getpid());
+    {
+      std::unique_ptr<TFile> file(TFile::Open(tempName.c_str(), "RECREATE"));
+      if(!file) return; //The cache is only an optimization
+      TNamed cachedKey("key", key.c_str());
+      file->WriteTObject(&cachedKey);
+      file->WriteTObject(&integral, "fluxIntegral");
+    }
+    if(std::rename(tempName.c_str(), fileName.c_str()) != 0) std::remove(tempName.c_str());
+  }
 }
 
 namespace util
 {
   PlotUtils::MnvH1D* GetFluxIntegral(const CVUniverse& univ, PlotUtils::MnvH1D* templateHist, const double Emin /*GeV*/, const double Emax /*GeV*/)
+  {
+    return GetFluxIntegral(univ.GetPlaylist(), univ.GetAnalysisNuPDG(), univ.UseNuEConstraint(), univ.GetNFluxUniverses(), templateHist, Emin, Emax);
+  }
+
+  PlotUtils::MnvH1D* GetFluxIntegral(const std::string& playlist, const int nuPDG, const bool useNuEConstraint, const int nFluxUniverses,
+                                     PlotUtils::MnvH1D* templateHist, const double Emin /*GeV*/, const double Emax /*GeV*/)
   {
     const bool useMuonCorrelations = true;
-    assert(!(useMuonCorrelations && (univ.GetAnalysisNuPDG() < 0)) && "Muon momentum correlations are not yet ready for ME antineutrino analyses!");
+    assert(!(useMuonCorrelations && (nuPDG < 0)) && "Muon momentum correlations are not yet ready for ME antineutrino analyses!");
+
+    //A cache hit never constructs the flux reweighter, so it never loads its flux files either
+    const char* cacheDir = getenv("MNV101_FLUX_CACHE");
+    std::string key, cacheFile;
+    if(cacheDir)
+    {
+      key = CacheKey(playlist, nuPDG, useNuEConstraint, nFluxUniverses, useMuonCorrelations, *templateHist, Emin, Emax);
+      cacheFile = std::string(cacheDir) + "/fluxIntegral_" + Hash(key) + ".root";
+      if(auto cached = ReadCached(cacheFile, key)) return cached;
+    }
+
+    auto& frw = PlotUtils::flux_reweighter(playlist, nuPDG, useNuEConstraint, nFluxUniverses);
+    auto integral = frw.GetIntegratedFluxReweighted(nuPDG, templateHist, Emin, Emax, useMuonCorrelations);
 
-    auto& frw = PlotUtils::flux_reweighter(univ.GetPlaylist(), univ.GetAnalysisNuPDG(), univ.UseNuEConstraint(), univ.GetNFluxUniverses());
-    return frw.GetIntegratedFluxReweighted(univ.GetAnalysisNuPDG(), templateHist, Emin, Emax, useMuonCorrelations);
+    if(cacheDir && integral) WriteCached(cacheFile, key, *integral);
+    return integral;
   }
 }
@@ -6,6 +6,9 @@
 #ifndef UTIL_GETFLUXINTEGRAL_H
 #define UTIL_GETFLUXINTEGRAL_H
 
+//c++ includes
+#include <string>
+
 class CVUniverse;
 
 namespace PlotUtils
@@ -16,6 +19,10 @@ namespace PlotUtils
 namespace util
 {
   PlotUtils::MnvH1D* GetFluxIntegral(const CVUniverse& univ, PlotUtils::MnvH1D* templateHist, const double Emin = 0 /*GeV*/, const double Emax = 100 /*GeV*/);
+
+  //Same as above for programs like HistogramSelectedEvents that know the flux configuration but don't have a CVUniverse.
+  PlotUtils::MnvH1D* GetFluxIntegral(const std::string& playlist, const int nuPDG, const bool useNuEConstraint, const int nFluxUniverses,
+                                     PlotUtils::MnvH1D* templateHist, const double Emin = 0 /*GeV*/, const double Emax = 100 /*GeV*/);
 }
 
 #endif //UTIL_GETFLUXINTEGRAL_H
@@ -1,11 +1,15 @@
 //File: GetIngredient.h
 //Brief: Get a histogram or other TObject from a TFile or TDirectory for one of the cross section extraction steps.
-//       Does a little error handling for me automatically.
+//       Does a little error handling for me automatically.  Histograms written in
+//       util/CompactHist.h's format are turned back into MnvH1Ds and MnvH2Ds.
 //Author: Andrew Olivier aolivier@ur.rochester.edu
 
 #ifndef UTIL_GETINGREDIENT_H
 #define UTIL_GETINGREDIENT_H
 
+//Includes from this package
+#include "util/CompactHist.h"
+
 //ROOT includes
 #include "TDirectoryFile.h"
 
@@ -22,6 +26,7 @@ namespace util
     if(obj == nullptr) throw std::runtime_error("Failed to get " + ingredient + " in " + dir.GetName());
   
     auto typed = dynamic_cast<TYPE*>(obj);
+    if(typed == nullptr) typed = FromCompact<TYPE>(*obj);
     if(typed == nullptr) throw std::runtime_error(std::string("Found ") + obj->GetName() + ", but it's not the right kind of TObject.");
   
     return typed;
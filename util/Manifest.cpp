@@ -0,0 +1,155 @@
+//File: Manifest.cpp
+//Brief: Table of contents for runEventLoop's output files.  Lists the name of every
+//       ingredient ExtractCrossSection needs for each Variable so that it can look
+//       them up directly instead of searching keys for substrings.  Files without a
+//       Manifest, like those from older versions of runEventLoop, get one built
+//       from their keys the way ExtractCrossSection used to search for them.
+
+//Includes from this package
+#include "util/Manifest.h"
+
+//ROOT includes
+#include "TDirectoryFile.h"
+#include "TTree.h"
+#include "TKey.h"
+#include "TParameter.h"
+
+//c++ includes
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  constexpr const char* manifestName = "Manifest";
+
+  //Every string member of Manifest::Entry with its branch name
+  std::vector<std::pair<const char*, std::string util::Manifest::Entry::*>> stringFields()
+  {
+    return {{"variable", &util::Manifest::Entry::variable},
+            {"data", &util::Manifest::Entry::data},
+            {"efficiencyNumerator", &util::Manifest::Entry::efficiencyNumerator},
+            {"efficiencyDenominator", &util::Manifest::Entry::efficiencyDenominator},
+            {"migration", &util::Manifest::Entry::migration},
+            {"selectedSignalReco", &util::Manifest::Entry::selectedSignalReco},
+            {"flux", &util::Manifest::Entry::flux},
+            {"fiducialNucleons", &util::Manifest::Entry::fiducialNucleons}};
+  }
+}
+
+namespace util
+{
+  Manifest::Manifest(TDirectoryFile& dir): fPOT(-1), fWasWritten(false)
+  {
+    auto tree = dynamic_cast<TTree*>(dir.Get(manifestName));
+    if(!tree)
+    {
+      FromKeys(dir);
+      return;
+    }
+
+    auto version = dynamic_cast<TParameter<int>*>(tree->GetUserInfo()->FindObject("schemaVersion"));
+    if(!version || version->GetVal() > schemaVersion)
+    {
+      throw std::runtime_error(std::string("The Manifest in ") + dir.GetName() + " was written by a newer version of this package.  I only understand up to schema version " + std::to_string(schemaVersion) + ".");
+    }
+
+    auto pot = dynamic_cast<TParameter<double>*>(tree->GetUserInfo()->FindObject("POTUsed"));
+    if(pot) fPOT = pot->GetVal();
+
+    Entry entry;
+    const auto fields = stringFields();
+    std::vector<std::string*> addresses;
+    for(const auto& field: fields) addresses.push_back(&(entry.*field.second));
+    for(size_t whichField = 0; whichField < fields.size(); ++whichField) tree->SetBranchAddress(fields[whichField].first, &addresses[whichField]);
+    auto backgrounds = &entry.backgrounds;
+    tree->SetBranchAddress("backgrounds", &backgrounds);
+
+    for(Long64_t whichEntry = 0; whichEntry < tree->GetEntries(); ++whichEntry)
+    {
+      tree->GetEntry(whichEntry);
+      fVariables.push_back(entry.variable);
+      fEntries[entry.variable] = entry;
+    }
+    tree->ResetBranchAddresses();
+    fWasWritten = true;
+  }
+
+  const Manifest::Entry& Manifest::Get(const std::string& variable) const
+  {
+    const auto found = fEntries.find(variable);
+    if(found == fEntries.end()) throw std::runtime_error("No ingredients for a Variable named " + variable);
+    return found->second;
+  }
+
+  double Manifest::GetPOT() const
+  {
+    if(fPOT < 0) throw std::runtime_error("Don't know how much POT went into these histograms.");
+    return fPOT;
+  }
+
+  void Manifest::Write(TDirectory& dir, const std::vector<Entry>& entries, const double POT)
+  {
+    TDirectory::TContext inDir(&dir); //New TTrees go in the current directory
+
+    Entry entry;
+    TTree tree(manifestName, "Ingredients for each Variable");
+    for(const auto& field: stringFields()) tree.Branch(field.first, &(entry.*field.second));
+    tree.Branch("backgrounds", &entry.backgrounds);
+
+    tree.GetUserInfo()->Add(new TParameter<int>("schemaVersion", schemaVersion));
+    tree.GetUserInfo()->Add(new TParameter<double>("POTUsed", POT));
+
+    for(const auto& toWrite: entries)
+    {
+      entry = toWrite;
+      tree.Fill();
+    }
+
+    tree.Write();
+  }
+
+  void Manifest::FromKeys(TDirectoryFile& dir)
+  {
+    auto pot = dynamic_cast<TParameter<double>*>(dir.Get("POTUsed"));
+    if(pot) fPOT = pot->GetVal();
+
+    std::vector<std::string> keyNames;
+    for(auto key: *dir.GetListOfKeys()) keyNames.push_back(key->GetName());
+
+    for(const auto& keyName: keyNames)
+    {
+      const size_t endOfPrefix = keyName.find("_data");
+      if(endOfPrefix == std::string::npos) continue;
+
+      const std::string prefix = keyName.substr(0, endOfPrefix);
+      if(fEntries.count(prefix)) continue;
+
+      Entry entry;
+      entry.variable = prefix;
+      entry.data = keyName;
+      entry.efficiencyNumerator = prefix + "_efficiency_numerator";
+      entry.efficiencyDenominator = prefix + "_efficiency_denominator";
+      entry.migration = prefix + "_migration";
+      entry.selectedSignalReco = prefix + "_selected_signal_reco";
+      entry.flux = prefix + "_reweightedflux_integrated";
+
+      //Dan: Use the same truth fiducial volume for all extractions.  The acceptance correction corrects data back to this fiducial even if the reco fiducial cut is different.
+      const auto fiducialFound = std::find_if(keyNames.begin(), keyNames.end(),
+                                              [&prefix](const std::string& name)
+                                              {
+                                                const size_t fiducialEnd = name.find("_fiducial_nucleons");
+                                                return (fiducialEnd != std::string::npos) && (prefix.find(name.substr(0, fiducialEnd)) != std::string::npos);
+                                              });
+      if(fiducialFound != keyNames.end()) entry.fiducialNucleons = *fiducialFound;
+
+      //Look for backgrounds with <prefix>_background_<name>
+      for(const auto& name: keyNames)
+      {
+        if(name.find(prefix + "_background_") != std::string::npos) entry.backgrounds.push_back(name);
+      }
+
+      fVariables.push_back(prefix);
+      fEntries[prefix] = entry;
+    }
+  }
+}
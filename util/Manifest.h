@@ -0,0 +1,70 @@
+//File: Manifest.h
+//Brief: Table of contents for runEventLoop's output files.  Lists the name of every
+//       ingredient ExtractCrossSection needs for each Variable so that it can look
+//       them up directly instead of searching keys for substrings.  Files without a
+//       Manifest, like those from older versions of runEventLoop, get one built
+//       from their keys the way ExtractCrossSection used to search for them.
+
+#ifndef UTIL_MANIFEST_H
+#define UTIL_MANIFEST_H
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+
+class TDirectory;
+class TDirectoryFile;
+
+namespace util
+{
+  class Manifest
+  {
+    public:
+      //Increment this when the meaning of a Manifest changes
+      static constexpr int schemaVersion = 1;
+
+      //Names of one Variable's ingredients.  Empty if a file doesn't have that ingredient.
+      struct Entry
+      {
+        std::string variable;
+        std::string data;
+        std::string efficiencyNumerator;
+        std::string efficiencyDenominator;
+        std::string migration;
+        std::string selectedSignalReco;
+        std::string flux;
+        std::string fiducialNucleons;
+        std::vector<std::string> backgrounds;
+      };
+
+      //Read dir's Manifest or make one from its keys if it doesn't have one.
+      //Throws std::runtime_error if the Manifest is from a newer schema version.
+      explicit Manifest(TDirectoryFile& dir);
+
+      //Variables in the same order they were written
+      const std::vector<std::string>& GetVariables() const { return fVariables; }
+
+      //Throws std::runtime_error if variable isn't in this Manifest
+      const Entry& Get(const std::string& variable) const;
+
+      //POT that went into dir's histograms.  Throws std::runtime_error if not known.
+      double GetPOT() const;
+
+      //False if this Manifest was built from keys
+      bool WasWritten() const { return fWasWritten; }
+
+      //Write a Manifest with entries to dir
+      static void Write(TDirectory& dir, const std::vector<Entry>& entries, const double POT);
+
+    private:
+      std::vector<std::string> fVariables;
+      std::map<std::string, Entry> fEntries;
+      double fPOT;
+      bool fWasWritten;
+
+      void FromKeys(TDirectoryFile& dir);
+  };
+}
+
+#endif //UTIL_MANIFEST_H
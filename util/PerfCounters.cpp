@@ -0,0 +1,148 @@
+//File: PerfCounters.cpp
+//Brief: Counts CPU cycles, instructions, last level cache misses, and branch
+//       misses with Linux's perf_event_open() around each stage of an event loop:
+//       SetEntry(), cuts, weights, and filling histograms.  Counts are summed per
+//       error band and written to a CSV file.
+
+//Includes from this package
+#include "util/PerfCounters.h"
+
+//c++ includes
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+//Linux includes
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  #ifdef __linux__
+  int OpenCounter(const uint64_t config, const int groupLeader)
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (groupLeader < 0);
+    attr.exclude_kernel = 1; //Allowed without privileges at the default perf_event_paranoid
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return syscall(__NR_perf_event_open, &attr, 0 /*this thread*/, -1 /*any CPU*/, groupLeader, 0);
+  }
+  #endif
+}
+
+namespace util
+{
+  PerfCounters::PerfCounters(): fLeader(-1)
+  {
+    fFDs.fill(-1);
+
+    #ifdef __linux__
+    const std::array<uint64_t, nCounters> configs = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for(int whichCounter = 0; whichCounter < nCounters; ++whichCounter)
+    {
+      fFDs[whichCounter] = OpenCounter(configs[whichCounter], fFDs[0]);
+      if(fFDs[whichCounter] < 0)
+      {
+        for(auto& fd: fFDs)
+        {
+          if(fd >= 0) close(fd);
+          fd = -1;
+        }
+        return;
+      }
+    }
+
+    fLeader = fFDs[0];
+    ioctl(fLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    #endif
+  }
+
+  PerfCounters::~PerfCounters()
+  {
+    #ifdef __linux__
+    for(const auto fd: fFDs)
+    {
+      if(fd >= 0) close(fd);
+    }
+    #endif
+  }
+
+  void PerfCounters::Read(std::array<uint64_t, nCounters>& values) const
+  {
+    #ifdef __linux__
+    //PERF_FORMAT_GROUP puts the number of counters first
+    std::array<uint64_t, nCounters + 1> buffer = {};
+    if(read(fLeader, buffer.data(), sizeof(buffer)) == sizeof(buffer))
+    {
+      std::copy(buffer.begin() + 1, buffer.end(), values.begin());
+      return;
+    }
+    #endif
+    values.fill(0);
+  }
+
+  bool PerfCounters::Write(const std::string& fileName) const
+  {
+    const std::array<std::string, nStages> stageNames = {"SetEntry", "cuts", "weight", "fill"};
+
+    std::ofstream csv(fileName);
+    csv << "band,stage,calls,cycles,instructions,LLCMisses,branchMisses\n";
+    for(const auto& row: fRows)
+    {
+      for(int whichStage = 0; whichStage < nStages; ++whichStage)
+      {
+        const auto& counts = row.second[whichStage];
+        if(counts.calls == 0) continue;
+        csv << row.first << "," << stageNames[whichStage] << "," << counts.calls;
+        for(const auto value: counts.values) csv << "," << value;
+        csv << "\n";
+      }
+    }
+    return static_cast<bool>(csv);
+  }
+
+  PerfCounters::Scope::Scope(const PerfCounters* counters, Row* row, const Stage stage): fCounters(counters), fSlot(row?&(*row)[stage]:nullptr)
+  {
+    if(fCounters) fCounters->Read(fBegin);
+  }
+
+  PerfCounters::Scope::~Scope()
+  {
+    if(!fCounters) return;
+
+    std::array<uint64_t, nCounters> end;
+    fCounters->Read(end);
+    for(int whichCounter = 0; whichCounter < nCounters; ++whichCounter) fSlot->values[whichCounter] += end[whichCounter] - fBegin[whichCounter];
+    ++fSlot->calls;
+  }
+
+  PerfCounters* PerfCounters::FromEnv()
+  {
+    if(!getenv("MNV101_PERF_COUNTERS")) return nullptr;
+
+    auto counters = new PerfCounters();
+    if(counters->IsValid()) return counters;
+
+    std::cerr << "MNV101_PERF_COUNTERS is set, but perf_event_open() failed.  Check /proc/sys/kernel/perf_event_paranoid.  Not counting.\n";
+    delete counters;
+    return nullptr;
+  }
+
+  std::string PerfCounters::FileName(const std::string& outFileName, const std::string& loopName)
+  {
+    return outFileName.substr(0, outFileName.rfind(".root")) + "_perf_" + loopName + ".csv";
+  }
+}
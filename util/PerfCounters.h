@@ -0,0 +1,80 @@
+//File: PerfCounters.h
+//Brief: Counts CPU cycles, instructions, last level cache misses, and branch
+//       misses with Linux's perf_event_open() around each stage of an event loop:
+//       SetEntry(), cuts, weights, and filling histograms.  Counts are summed per
+//       error band and written to a CSV file.  Fills that miss the cache a lot
+//       are memory-bound, and reweighting with many instructions per cycle is
+//       compute-bound.  Unlike gprof, this doesn't change the code being measured.
+//
+//       Counters only count the thread that made them, so each loop makes its own.
+
+#ifndef UTIL_PERFCOUNTERS_H
+#define UTIL_PERFCOUNTERS_H
+
+//c++ includes
+#include <string>
+#include <map>
+#include <array>
+#include <cstdint>
+
+namespace util
+{
+  class PerfCounters
+  {
+    public:
+      enum Stage { setEntry, cuts, weight, fill, nStages };
+      enum Counter { cycles, instructions, llcMisses, branchMisses, nCounters };
+
+      struct Counts
+      {
+        std::array<uint64_t, nCounters> values = {};
+        uint64_t calls = 0;
+      };
+      using Row = std::array<Counts, nStages>;
+
+      //Counts the calling thread.  Check IsValid() because the kernel might not allow it.
+      PerfCounters();
+      ~PerfCounters();
+
+      PerfCounters(const PerfCounters&) = delete;
+      PerfCounters& operator =(const PerfCounters&) = delete;
+
+      bool IsValid() const { return fLeader >= 0; }
+
+      //Look this up once per band, not once per universe
+      Row& GetRow(const std::string& band) { return fRows[band]; }
+
+      //One line per band and stage.  Returns false if fileName can't be written.
+      bool Write(const std::string& fileName) const;
+
+      //Adds whatever happens during its lifetime to one stage of a Row.
+      //Does nothing if counters is nullptr so that loops can use it unconditionally.
+      class Scope
+      {
+        public:
+          Scope(const PerfCounters* counters, Row* row, const Stage stage);
+          ~Scope();
+
+        private:
+          const PerfCounters* fCounters;
+          Counts* fSlot;
+          std::array<uint64_t, nCounters> fBegin;
+      };
+
+      //A new PerfCounters if environment variable MNV101_PERF_COUNTERS is set and
+      //the kernel allows it.  nullptr otherwise.
+      static PerfCounters* FromEnv();
+
+      //Where a loop named loopName writes its counts next to an output file named outFileName
+      static std::string FileName(const std::string& outFileName, const std::string& loopName);
+
+    private:
+      int fLeader; //Reading the group leader reads every counter at once
+      std::array<int, nCounters> fFDs;
+      std::map<std::string, Row> fRows;
+
+      void Read(std::array<uint64_t, nCounters>& values) const;
+  };
+}
+
+#endif //UTIL_PERFCOUNTERS_H
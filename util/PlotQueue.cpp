@@ -0,0 +1,73 @@
+//File: PlotQueue.cpp
+//Brief: Draws plots on a background thread so that cross section extraction doesn't
+//       wait on TCanvas and PNG encoding.  ROOT graphics aren't thread-safe, so all
+//       plots are drawn one at a time on the same thread in the order they were
+//       pushed.  The destructor waits for every plot to be drawn.
+
+//Includes from this package
+#include "util/PlotQueue.h"
+
+//c++ includes
+#include <iostream>
+#include <exception>
+
+namespace util
+{
+  PlotQueue::PlotQueue(const bool async): fDone(false), fAsync(async)
+  {
+    if(fAsync) fGraphicsThread = std::thread(&PlotQueue::Run, this);
+  }
+
+  PlotQueue::~PlotQueue()
+  {
+    if(!fAsync) return;
+
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fDone = true;
+    }
+    fReady.notify_one();
+    fGraphicsThread.join();
+  }
+
+  void PlotQueue::Push(std::function<void()> draw)
+  {
+    if(!fAsync)
+    {
+      draw();
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fPending.push_back(std::move(draw));
+    }
+    fReady.notify_one();
+  }
+
+  void PlotQueue::Run()
+  {
+    while(true)
+    {
+      std::function<void()> draw;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fReady.wait(lock, [this]() { return fDone || !fPending.empty(); });
+        if(fPending.empty()) return; //fDone and nothing left to draw
+
+        draw = std::move(fPending.front());
+        fPending.pop_front();
+      }
+
+      //A plot that fails shouldn't stop the others
+      try
+      {
+        draw();
+      }
+      catch(const std::exception& e)
+      {
+        std::cerr << "Failed to draw a plot: " << e.what() << "\n";
+      }
+    }
+  }
+}
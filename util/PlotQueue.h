@@ -0,0 +1,45 @@
+//File: PlotQueue.h
+//Brief: Draws plots on a background thread so that cross section extraction doesn't
+//       wait on TCanvas and PNG encoding.  ROOT graphics aren't thread-safe, so all
+//       plots are drawn one at a time on the same thread in the order they were
+//       pushed.  The destructor waits for every plot to be drawn.
+
+#ifndef UTIL_PLOTQUEUE_H
+#define UTIL_PLOTQUEUE_H
+
+//c++ includes
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace util
+{
+  class PlotQueue
+  {
+    public:
+      //If !async, Push() draws right away on the calling thread.  That's for older
+      //ROOT versions that can't handle more than 1 thread.
+      explicit PlotQueue(const bool async = true);
+      ~PlotQueue();
+
+      PlotQueue(const PlotQueue&) = delete;
+      PlotQueue& operator =(const PlotQueue&) = delete;
+
+      //draw must own everything it needs.  Whatever it captures might not exist when it's run otherwise.
+      void Push(std::function<void()> draw);
+
+    private:
+      std::deque<std::function<void()>> fPending;
+      std::mutex fMutex;
+      std::condition_variable fReady;
+      bool fDone;
+      bool fAsync;
+      std::thread fGraphicsThread;
+
+      void Run();
+  };
+}
+
+#endif //UTIL_PLOTQUEUE_H
@@ -0,0 +1,99 @@
+//File: Prefetch.cpp
+//Brief: Reads files into the operating system's page cache ahead of time so that
+//       the reweighters and the flux reweighter don't wait on the disk or CVMFS one
+//       file at a time when they open their tables.  Files are memory-mapped
+//       read-only, so every process on a node shares the same cached pages.
+
+//Includes from this package
+#include "util/Prefetch.h"
+
+//c++ includes
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <algorithm>
+
+//POSIX includes
+#include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+  size_t PrefetchOne(const std::string& fileName)
+  {
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0) return 0;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+      close(fd);
+      return 0;
+    }
+
+    const size_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); //The mapping keeps the file open
+    if(mapped == MAP_FAILED) return 0;
+
+    //Ask for the whole file at once, then wait for every page to actually arrive
+    madvise(mapped, size, MADV_WILLNEED);
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const volatile char* bytes = static_cast<const char*>(mapped);
+    char sum = 0;
+    for(size_t offset = 0; offset < size; offset += pageSize) sum += bytes[offset];
+    (void)sum;
+
+    munmap(mapped, size);
+    return size;
+  }
+}
+
+namespace util
+{
+  std::vector<std::string> ExpandFilePatterns(const std::string& patterns, const std::string& baseDir)
+  {
+    std::vector<std::string> files;
+    std::stringstream allPatterns(patterns);
+    for(std::string pattern; std::getline(allPatterns, pattern, ';');)
+    {
+      if(pattern.empty()) continue;
+      if(pattern.front() != '/' && !baseDir.empty()) pattern = baseDir + "/" + pattern;
+
+      glob_t matches;
+      if(glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+      {
+        files.insert(files.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+      }
+      globfree(&matches);
+    }
+
+    //Don't read the same file twice when patterns overlap
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+  }
+
+  size_t Prefetch(const std::vector<std::string>& files, const size_t nThreads)
+  {
+    //Each worker takes the next file nobody has started yet
+    std::atomic<size_t> nextFile(0), nBytes(0);
+    const auto work = [&]()
+                      {
+                        for(size_t whichFile = nextFile++; whichFile < files.size(); whichFile = nextFile++)
+                        {
+                          nBytes += PrefetchOne(files[whichFile]);
+                        }
+                      };
+
+    std::vector<std::thread> workers;
+    for(size_t whichThread = 1; whichThread < std::min(std::max<size_t>(nThreads, 1), files.size()); ++whichThread) workers.emplace_back(work);
+    work();
+    for(auto& worker: workers) worker.join();
+
+    return nBytes;
+  }
+}
@@ -0,0 +1,26 @@
+//File: Prefetch.h
+//Brief: Reads files into the operating system's page cache ahead of time so that
+//       the reweighters and the flux reweighter don't wait on the disk or CVMFS one
+//       file at a time when they open their tables.  Files are memory-mapped
+//       read-only, so every process on a node shares the same cached pages.
+
+#ifndef UTIL_PREFETCH_H
+#define UTIL_PREFETCH_H
+
+//c++ includes
+#include <string>
+#include <vector>
+
+namespace util
+{
+  //Expand each ;-separated glob pattern in patterns.  Relative patterns are
+  //relative to baseDir.  Patterns that match nothing are left out.
+  std::vector<std::string> ExpandFilePatterns(const std::string& patterns, const std::string& baseDir);
+
+  //Map every file in files and touch each of its pages on up to nThreads threads.
+  //Returns the number of bytes read.  Files that can't be opened are skipped
+  //because whoever really needs them will report that.
+  size_t Prefetch(const std::vector<std::string>& files, const size_t nThreads);
+}
+
+#endif //UTIL_PREFETCH_H
@@ -0,0 +1,111 @@
+//File: Preflight.cpp
+//Brief: Checks that every file in a playlist can really be read before an event
+//       loop spends hours on it.  A file that fails is retried with a growing
+//       wait in between, which gets past most transient xrootd and dCache errors.
+//       Files that still can't be read are left out of the playlist entirely,
+//       so POT counted from the remaining files stays consistent with the
+//       events that were actually looped over.
+
+//Includes from this package
+#include "util/Preflight.h"
+
+//ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+#include "TDirectory.h"
+#include "TObjString.h"
+#include "TList.h"
+
+//c++ includes
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+  bool IsReadable(const std::string& fileName, const std::vector<std::string>& treeNames)
+  {
+    //Programs that use CrashOnROOTMessage turn ROOT errors into exceptions
+    try
+    {
+      std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+      if(!file || file->IsZombie()) return false;
+
+      for(const auto& treeName: treeNames)
+      {
+        auto tree = dynamic_cast<TTree*>(file->Get(treeName.c_str()));
+        if(!tree) return false;
+        if(tree->GetEntries() > 0 && tree->GetEntry(0) <= 0) return false;
+      }
+      return true;
+    }
+    catch(...)
+    {
+      return false;
+    }
+  }
+}
+
+namespace util
+{
+  PreflightResult Preflight(const std::string& playlistFile, const std::vector<std::string>& treeNames,
+                            const int nRetries, const double firstWait, const size_t nThreads)
+  {
+    std::vector<std::string> files;
+    std::ifstream playlist(playlistFile);
+    for(std::string file; playlist >> file;) files.push_back(file);
+
+    //Each worker takes the next file nobody has started yet
+    std::vector<char> isReadable(files.size(), false);
+    std::atomic<size_t> nextFile(0);
+    const auto work = [&]()
+                      {
+                        for(size_t whichFile = nextFile++; whichFile < files.size(); whichFile = nextFile++)
+                        {
+                          double wait = firstWait;
+                          for(int attempt = 0; attempt <= nRetries && !isReadable[whichFile]; ++attempt)
+                          {
+                            if(attempt > 0)
+                            {
+                              std::cerr << "Failed to read " << files[whichFile] << ".  Trying again in " << wait << " seconds.\n";
+                              std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+                              wait *= 2;
+                            }
+                            isReadable[whichFile] = IsReadable(files[whichFile], treeNames);
+                          }
+                        }
+                      };
+
+    std::vector<std::thread> workers;
+    for(size_t whichThread = 1; whichThread < std::min(std::max<size_t>(nThreads, 1), files.size()); ++whichThread) workers.emplace_back(work);
+    work();
+    for(auto& worker: workers) worker.join();
+
+    //Keep the playlist's order
+    PreflightResult result;
+    for(size_t whichFile = 0; whichFile < files.size(); ++whichFile)
+    {
+      (isReadable[whichFile]?result.readable:result.skipped).push_back(files[whichFile]);
+    }
+    return result;
+  }
+
+  bool WritePlaylist(const std::vector<std::string>& files, const std::string& fileName)
+  {
+    std::ofstream playlist(fileName);
+    for(const auto& file: files) playlist << file << "\n";
+    return static_cast<bool>(playlist);
+  }
+
+  void WriteSkippedFiles(const std::vector<std::string>& skipped, TDirectory& dir)
+  {
+    TList names;
+    names.SetOwner(true);
+    for(const auto& file: skipped) names.Add(new TObjString(file.c_str()));
+    dir.WriteTObject(&names, "SkippedFiles", "SingleKey");
+  }
+}
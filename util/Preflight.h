@@ -0,0 +1,73 @@
+//File: Preflight.h
+//Brief: Checks that every file in a playlist can really be read before an event
+//       loop spends hours on it.  A file that fails is retried with a growing
+//       wait in between, which gets past most transient xrootd and dCache errors.
+//       Files that still can't be read are left out of the playlist entirely,
+//       so POT counted from the remaining files stays consistent with the
+//       events that were actually looped over.
+
+#ifndef UTIL_PREFLIGHT_H
+#define UTIL_PREFLIGHT_H
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+class TDirectory;
+
+namespace util
+{
+  struct PreflightResult
+  {
+    std::vector<std::string> readable, skipped;
+  };
+
+  //How many more times to try a read that failed.  The first wait is firstWait
+  //seconds, and each wait after that is twice as long.
+  struct RetryPolicy
+  {
+    int nRetries = 0;
+    double firstWait = 10; //seconds
+  };
+
+  //Open each file in playlistFile and read the first entry of each tree in treeNames.
+  //Each file gets nRetries more tries after the first one.  The first wait is
+  //firstWait seconds, and each wait after that is twice as long.  Files are checked
+  //on up to nThreads threads.  Call ROOT::EnableThreadSafety() first if nThreads > 1.
+  PreflightResult Preflight(const std::string& playlistFile, const std::vector<std::string>& treeNames,
+                            const int nRetries, const double firstWait, const size_t nThreads);
+
+  //Call read() again with the same waits as Preflight() each time it throws an EXCEPTION.
+  //Rethrows after policy.nRetries retries.  Doesn't allocate unless read() fails.
+  template <class EXCEPTION, class FUNC>
+  void Retry(FUNC&& read, const RetryPolicy& policy, const long long entry)
+  {
+    double wait = policy.firstWait;
+    for(int attempt = 0;; ++attempt)
+    {
+      try
+      {
+        read();
+        return;
+      }
+      catch(const EXCEPTION& e)
+      {
+        if(attempt >= policy.nRetries) throw;
+        std::cerr << "Failed to read entry " << entry << ": " << e.what() << "\nTrying again in " << wait << " seconds.\n";
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        wait *= 2;
+      }
+    }
+  }
+
+  //Write files as a new playlist named fileName.  Returns false if it can't be written.
+  bool WritePlaylist(const std::vector<std::string>& files, const std::string& fileName);
+
+  //Record which files were skipped in dir so that nobody mistakes the output for the full playlist
+  void WriteSkippedFiles(const std::vector<std::string>& skipped, TDirectory& dir);
+}
+
+#endif //UTIL_PREFLIGHT_H
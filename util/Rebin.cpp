@@ -0,0 +1,192 @@
+//File: Rebin.cpp
+//Brief: Tools for filling Variables with a fine, uniform binning once and picking
+//       the analysis binning later.  FineBinning() makes a grid that every bin edge
+//       of a Variable lines up with, and Rebin() merges fine bins into any
+//       binning whose edges are on that grid.  Error bands are rebinned along
+//       with the CV so that systematics stay consistent.
+
+//Includes from this package
+#include "util/Rebin.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#include "PlotUtils/MnvH2D.h"
+#pragma GCC diagnostic pop
+
+//c++ includes
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  //Greatest common divisor for bin widths that are only approximately
+  //multiples of each other because of floating point.
+  double gcd(double a, double b, const double tolerance)
+  {
+    while(b > tolerance)
+    {
+      double remainder = std::fmod(a, b);
+      if(remainder > b - tolerance) remainder = 0;
+      a = b;
+      b = remainder;
+    }
+    return a;
+  }
+
+  //Throw if any edge isn't also an edge of axis.  Edges outside the axis
+  //would otherwise line up with the edge of underflow or overflow.
+  void checkAlignment(const TAxis& axis, const std::vector<double>& edges, const std::string& histName)
+  {
+    const double tolerance = 1e-6 * (axis.GetXmax() - axis.GetXmin());
+    for(const double edge: edges)
+    {
+      if(edge < axis.GetXmin() - tolerance || edge > axis.GetXmax() + tolerance)
+      {
+        std::stringstream err;
+        err << "Bin edge " << edge << " is outside the fine binning of " << histName << " from " << axis.GetXmin() << " to " << axis.GetXmax();
+        throw std::runtime_error(err.str());
+      }
+
+      const int bin = axis.FindFixBin(edge + tolerance);
+      if(std::fabs(axis.GetBinLowEdge(bin) - edge) > tolerance && std::fabs(axis.GetBinUpEdge(bin) - edge) > tolerance)
+      {
+        std::stringstream err;
+        err << "Bin edge " << edge << " doesn't line up with the fine binning of " << histName;
+        throw std::runtime_error(err.str());
+      }
+    }
+  }
+
+  //Move each fine bin's content into the coarse bin that contains its center.
+  //Underflow and overflow stay underflow and overflow.
+  void rebinInto(const TH1& fine, TH1& coarse, const bool average)
+  {
+    std::vector<double> content(coarse.GetNcells(), 0), err2(coarse.GetNcells(), 0), nMerged(coarse.GetNcells(), 0);
+
+    const int nFineX = fine.GetNbinsX() + 2, nFineY = (fine.GetDimension() > 1)?fine.GetNbinsY() + 2:1;
+    for(int fineX = 0; fineX < nFineX; ++fineX)
+    {
+      const int coarseX = coarse.GetXaxis()->FindFixBin(fine.GetXaxis()->GetBinCenter(fineX));
+      for(int fineY = 0; fineY < nFineY; ++fineY)
+      {
+        const int coarseY = (nFineY > 1)?coarse.GetYaxis()->FindFixBin(fine.GetYaxis()->GetBinCenter(fineY)):0;
+        const int fineBin = fine.GetBin(fineX, fineY), coarseBin = coarse.GetBin(coarseX, coarseY);
+
+        content[coarseBin] += fine.GetBinContent(fineBin);
+        err2[coarseBin] += fine.GetBinError(fineBin) * fine.GetBinError(fineBin);
+        ++nMerged[coarseBin];
+      }
+    }
+
+    for(int whichBin = 0; whichBin < coarse.GetNcells(); ++whichBin)
+    {
+      const double norm = (average && nMerged[whichBin] > 0)?nMerged[whichBin]:1;
+      coarse.SetBinContent(whichBin, content[whichBin] / norm);
+      coarse.SetBinError(whichBin, std::sqrt(err2[whichBin]) / norm);
+    }
+  }
+
+  //Same as above for every universe of every error band.  Call after the coarse CV is filled
+  //because new error bands copy it.
+  template <class MNVHIST>
+  void rebinBands(const MNVHIST& fine, MNVHIST& coarse, const bool average)
+  {
+    for(const auto& name: fine.GetVertErrorBandNames())
+    {
+      const auto fineBand = fine.GetVertErrorBand(name);
+      coarse.AddVertErrorBand(name, fineBand->GetNHists());
+      auto coarseBand = coarse.GetVertErrorBand(name);
+      coarseBand->SetUseSpreadError(fineBand->GetUseSpreadError());
+      for(unsigned int whichUniv = 0; whichUniv < fineBand->GetNHists(); ++whichUniv)
+      {
+        rebinInto(*fineBand->GetHist(whichUniv), *coarseBand->GetHist(whichUniv), average);
+      }
+    }
+
+    for(const auto& name: fine.GetLatErrorBandNames())
+    {
+      const auto fineBand = fine.GetLatErrorBand(name);
+      coarse.AddLatErrorBand(name, fineBand->GetNHists());
+      auto coarseBand = coarse.GetLatErrorBand(name);
+      coarseBand->SetUseSpreadError(fineBand->GetUseSpreadError());
+      for(unsigned int whichUniv = 0; whichUniv < fineBand->GetNHists(); ++whichUniv)
+      {
+        rebinInto(*fineBand->GetHist(whichUniv), *coarseBand->GetHist(whichUniv), average);
+      }
+    }
+  }
+}
+
+namespace util
+{
+  std::vector<double> FineBinning(const std::vector<double>& edges, const int nSubdivisions)
+  {
+    const double range = edges.back() - edges.front(),
+                 tolerance = 1e-6 * range;
+
+    double width = range;
+    for(size_t whichEdge = 1; whichEdge < edges.size(); ++whichEdge)
+    {
+      width = gcd(width, edges[whichEdge] - edges.front(), tolerance);
+    }
+    width /= nSubdivisions;
+
+    const int nBins = std::lround(range / width);
+    std::vector<double> fine;
+    for(int whichEdge = 0; whichEdge <= nBins; ++whichEdge) fine.push_back(edges.front() + width * whichEdge);
+
+    return fine;
+  }
+
+  PlotUtils::MnvH1D* Rebin(const PlotUtils::MnvH1D& fine, const std::vector<double>& edges, const bool average)
+  {
+    checkAlignment(*fine.GetXaxis(), edges, fine.GetName());
+
+    auto coarse = new PlotUtils::MnvH1D(fine.GetName(), fine.GetTitle(), edges.size() - 1, edges.data());
+    coarse->GetXaxis()->SetTitle(fine.GetXaxis()->GetTitle());
+    coarse->GetYaxis()->SetTitle(fine.GetYaxis()->GetTitle());
+
+    rebinInto(fine, *coarse, average);
+    rebinBands(fine, *coarse, average);
+
+    return coarse;
+  }
+
+  PlotUtils::MnvH2D* Rebin(const PlotUtils::MnvH2D& fine, const std::vector<double>& edges)
+  {
+    checkAlignment(*fine.GetXaxis(), edges, fine.GetName());
+    checkAlignment(*fine.GetYaxis(), edges, fine.GetName());
+
+    auto coarse = new PlotUtils::MnvH2D(fine.GetName(), fine.GetTitle(), edges.size() - 1, edges.data(), edges.size() - 1, edges.data());
+    coarse->GetXaxis()->SetTitle(fine.GetXaxis()->GetTitle());
+    coarse->GetYaxis()->SetTitle(fine.GetYaxis()->GetTitle());
+
+    rebinInto(fine, *coarse, false);
+    rebinBands(fine, *coarse, false);
+
+    return coarse;
+  }
+
+  bool ParseBinning(const std::string& arg, std::string& name, std::vector<double>& edges)
+  {
+    const size_t equals = arg.find("=");
+    if(equals == std::string::npos || equals == 0) return false;
+
+    name = arg.substr(0, equals);
+    edges.clear();
+
+    std::stringstream edgeList(arg.substr(equals + 1));
+    std::string edge;
+    while(std::getline(edgeList, edge, ','))
+    {
+      try { edges.push_back(std::stod(edge)); }
+      catch(const std::exception& /*e*/) { return false; }
+    }
+
+    return edges.size() > 1 && std::is_sorted(edges.begin(), edges.end());
+  }
+}
@@ -0,0 +1,41 @@
+//File: Rebin.h
+//Brief: Tools for filling Variables with a fine, uniform binning once and picking
+//       the analysis binning later.  FineBinning() makes a grid that every bin edge
+//       of a Variable lines up with, and Rebin() merges fine bins into any
+//       binning whose edges are on that grid.  Error bands are rebinned along
+//       with the CV so that systematics stay consistent.
+
+#ifndef UTIL_REBIN_H
+#define UTIL_REBIN_H
+
+//c++ includes
+#include <string>
+#include <vector>
+
+namespace PlotUtils
+{
+  class MnvH1D;
+  class MnvH2D;
+}
+
+namespace util
+{
+  //Uniform bins from edges.front() to edges.back() whose width is the largest width that
+  //every edge lines up with divided by nSubdivisions.  So, edges is always a valid
+  //target binning for Rebin(), and larger nSubdivisions allow more new binnings.
+  std::vector<double> FineBinning(const std::vector<double>& edges, const int nSubdivisions = 1);
+
+  //Merge bins of fine into edges.  Throws std::runtime_error if edges don't line up
+  //with fine's bins.  Set average for histograms like the integrated flux that have
+  //the same value in every bin instead of a number of events.
+  PlotUtils::MnvH1D* Rebin(const PlotUtils::MnvH1D& fine, const std::vector<double>& edges, const bool average = false);
+
+  //Rebin both axes of a migration matrix
+  PlotUtils::MnvH2D* Rebin(const PlotUtils::MnvH2D& fine, const std::vector<double>& edges);
+
+  //Parse <name>=<edge>,<edge>,... from the command line.  Returns false if arg isn't
+  //formatted like that or edges aren't in increasing order.
+  bool ParseBinning(const std::string& arg, std::string& name, std::vector<double>& edges);
+}
+
+#endif //UTIL_REBIN_H
@@ -0,0 +1,142 @@
+//File: TaskGraph.cpp
+//Brief: Runs stages of a program concurrently when nothing stops them from
+//       running at the same time.  A stage waits for every stage it runs after.
+//       It also waits for stages that need a shared resource, like a global
+//       flag or a singleton, in a different state.  Stages that need a resource
+//       in the same state can overlap.  Reports how long each stage took.
+
+//Includes from this package
+#include "util/TaskGraph.h"
+
+//c++ includes
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace util
+{
+  TaskGraph::id_t TaskGraph::Add(const std::string& name, std::function<void()> work, const std::vector<id_t>& after,
+                                 const std::map<std::string, std::string>& resources)
+  {
+    for(const auto dependency: after)
+    {
+      if(dependency >= fTasks.size()) throw std::invalid_argument("Stage " + name + " runs after a stage that hasn't been added yet.");
+    }
+
+    Task task;
+    task.name = name;
+    task.work = work;
+    task.after = after;
+    task.resources = resources;
+    fTasks.push_back(task);
+    return fTasks.size() - 1;
+  }
+
+  void TaskGraph::Run(const size_t nThreads)
+  {
+    fRunStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(size_t whichThread = 1; whichThread < std::max<size_t>(nThreads, 1); ++whichThread) workers.emplace_back(&TaskGraph::Work, this);
+    Work();
+    for(auto& worker: workers) worker.join();
+
+    if(fFailure) std::rethrow_exception(fFailure);
+  }
+
+  void TaskGraph::PrintDurations(std::ostream& os) const
+  {
+    for(const auto& task: fTasks)
+    {
+      if(task.finished)
+      {
+        os << std::setw(40) << std::left << task.name << std::fixed << std::setprecision(1) << std::right
+           << std::setw(8) << task.start << " s to " << std::setw(8) << task.start + task.seconds << " s (" << task.seconds << " s)\n";
+      }
+    }
+  }
+
+  TaskGraph::id_t TaskGraph::NextReady() const
+  {
+    for(id_t whichTask = 0; whichTask < fTasks.size(); ++whichTask)
+    {
+      const auto& task = fTasks[whichTask];
+      if(task.started) continue;
+
+      const bool depsDone = std::all_of(task.after.begin(), task.after.end(), [this](const id_t dep) { return fTasks[dep].finished; });
+      const bool resourcesFree = std::all_of(task.resources.begin(), task.resources.end(),
+                                             [this](const std::pair<const std::string, std::string>& resource)
+                                             {
+                                               const auto found = fHeld.find(resource.first);
+                                               return found == fHeld.end() || found->second.second == 0 || found->second.first == resource.second;
+                                             });
+      if(depsDone && resourcesFree) return whichTask;
+    }
+
+    return fTasks.size();
+  }
+
+  void TaskGraph::Work()
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    while(true)
+    {
+      //Stop once every stage is done or once no new stage can start after a failure
+      const bool allStarted = std::all_of(fTasks.begin(), fTasks.end(), [](const Task& task) { return task.started; });
+      if((allStarted || fFailure) && fNRunning == 0) break;
+      if(allStarted || fFailure)
+      {
+        fChanged.wait(lock);
+        continue;
+      }
+
+      const id_t next = NextReady();
+      if(next == fTasks.size())
+      {
+        if(fNRunning == 0)
+        {
+          fFailure = std::make_exception_ptr(std::logic_error("Stages can never run because they wait on each other."));
+          fChanged.notify_all();
+          continue;
+        }
+        fChanged.wait(lock);
+        continue;
+      }
+
+      //Take this stage's resources and run it without the lock
+      auto& task = fTasks[next];
+      task.started = true;
+      ++fNRunning;
+      for(const auto& resource: task.resources)
+      {
+        auto& held = fHeld[resource.first];
+        held.first = resource.second;
+        ++held.second;
+      }
+
+      lock.unlock();
+      std::exception_ptr failure;
+      const auto start = std::chrono::steady_clock::now();
+      try
+      {
+        task.work();
+      }
+      catch(...)
+      {
+        failure = std::current_exception();
+      }
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start,
+                                          startedAfter = start - fRunStart;
+      lock.lock();
+
+      task.start = startedAfter.count();
+      task.seconds = elapsed.count();
+      task.finished = !failure;
+      if(failure && !fFailure) fFailure = failure;
+      for(const auto& resource: task.resources) --fHeld[resource.first].second;
+      --fNRunning;
+      fChanged.notify_all();
+    }
+  }
+}
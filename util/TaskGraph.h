@@ -0,0 +1,76 @@
+//File: TaskGraph.h
+//Brief: Runs stages of a program concurrently when nothing stops them from
+//       running at the same time.  A stage waits for every stage it runs after.
+//       It also waits for stages that need a shared resource, like a global
+//       flag or a singleton, in a different state.  Stages that need a resource
+//       in the same state can overlap.  Reports how long each stage took.
+
+#ifndef UTIL_TASKGRAPH_H
+#define UTIL_TASKGRAPH_H
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <ostream>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+
+namespace util
+{
+  class TaskGraph
+  {
+    public:
+      using id_t = size_t;
+
+      //Add a stage named name that runs work after every stage in after finishes.
+      //resources maps each resource work uses to the state it needs that
+      //resource in.  Give a resource a state no other stage uses to have it to
+      //this stage alone.
+      id_t Add(const std::string& name, std::function<void()> work, const std::vector<id_t>& after = {},
+               const std::map<std::string, std::string>& resources = {});
+
+      //Run every stage with up to nThreads at once.  With 1 thread, stages run in
+      //the order they were added as long as that respects after.  If a stage throws,
+      //no more stages start, and the first exception is rethrown once running stages finish.
+      void Run(const size_t nThreads);
+
+      //When each stage that ran started and finished, in seconds since Run() started,
+      //and how long it took.  Shows which stages really overlapped.
+      void PrintDurations(std::ostream& os) const;
+
+    private:
+      struct Task
+      {
+        std::string name;
+        std::function<void()> work;
+        std::vector<id_t> after;
+        std::map<std::string, std::string> resources;
+
+        bool started = false;
+        bool finished = false;
+        double start = 0; //Seconds after Run() started
+        double seconds = 0;
+      };
+
+      std::vector<Task> fTasks;
+      std::chrono::steady_clock::time_point fRunStart;
+
+      //Shared between worker threads during Run()
+      std::mutex fMutex;
+      std::condition_variable fChanged;
+      std::map<std::string, std::pair<std::string, int>> fHeld; //Resource -> (state, number of stages using it)
+      std::exception_ptr fFailure;
+      size_t fNRunning = 0;
+
+      //Returns fTasks.size() if no stage can start now.  Call with fMutex locked.
+      id_t NextReady() const;
+
+      void Work();
+  };
+}
+
+#endif //UTIL_TASKGRAPH_H
@@ -0,0 +1,347 @@
+//File: Unfold.cpp
+//Brief: d'Agostini unfolding for cross section extraction.  UnfoldHist() hands
+//       the whole MnvH1D to MnvUnfold.  UnfoldHistParallel() unfolds each
+//       universe of each error band as its own TH1D on a pool of threads and
+//       puts the results back together into an MnvH1D.  Both push the
+//       statistical covariance from unfolding the CV as "unfoldingCov".
+//       Set MNV101_CHECK_UNFOLDING_COV to compare it to the second unfolding pass
+//       this covariance used to come from.
+//       BayesUnfolder does the same iterations without RooUnfold so that
+//       every iteration count of a warping study comes out of one pass.
+
+//Includes from this package
+#include "util/Unfold.h"
+
+//UnfoldUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "MinervaUnfold/MnvUnfold.h"
+
+//PlotUtils includes
+#include "PlotUtils/MnvH1D.h"
+#include "PlotUtils/MnvH2D.h"
+#pragma GCC diagnostic pop
+
+//ROOT includes
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TMatrixD.h"
+
+//c++ includes
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  //Relative to the largest element of the second pass's covariance
+  constexpr double maxCovDiff = 1e-6;
+
+  //The statistical covariance the way it used to be calculated: by unfolding the
+  //CVs of h_folded and h_migration a second time with a new MnvUnfold.
+  TMatrixD SecondPassCov(PlotUtils::MnvH1D* h_unfolded, PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter)
+  {
+    MinervaUnfold::MnvUnfold unfold;
+    TMatrixD covMatrix;
+    TH1D* hUnfolded = new TH1D(h_unfolded->GetCVHistoWithStatError());
+    TH1D hReco(h_migration->ProjectionX()->GetCVHistoWithStatError()),
+         hTruth(h_migration->ProjectionY()->GetCVHistoWithStatError()),
+         hFolded(h_folded->GetCVHistoWithStatError());
+    TH2D hMigration(h_migration->GetCVHistoWithStatError());
+    TH1D* original = hUnfolded;
+    unfold.UnfoldHisto(hUnfolded, covMatrix, &hMigration, &hReco, &hTruth, &hFolded, RooUnfold::kBayes, num_iter);
+    if(hUnfolded != original) delete original;
+    delete hUnfolded;
+    return covMatrix;
+  }
+
+  //Compare the covariance from the first pass to SecondPassCov().  Returns the
+  //second pass's covariance if they disagree so the result matches older versions.
+  TMatrixD CheckUnfoldingCov(const TMatrixD& firstPass, PlotUtils::MnvH1D* h_unfolded, PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter)
+  {
+    const TMatrixD secondPass = SecondPassCov(h_unfolded, h_folded, h_migration, num_iter);
+    if(firstPass.GetNrows() != secondPass.GetNrows() || firstPass.GetNcols() != secondPass.GetNcols())
+    {
+      std::cerr << "Unfolding covariance for " << h_folded->GetName() << " is " << firstPass.GetNrows() << "x" << firstPass.GetNcols()
+                << ", but the second pass gives " << secondPass.GetNrows() << "x" << secondPass.GetNcols() << ".  Using the second pass.\n";
+      return secondPass;
+    }
+
+    double maxElement = 0, maxDiff = 0;
+    for(int row = 0; row < secondPass.GetNrows(); ++row)
+    {
+      for(int col = 0; col < secondPass.GetNcols(); ++col)
+      {
+        maxElement = std::max(maxElement, std::fabs(secondPass(row, col)));
+        maxDiff = std::max(maxDiff, std::fabs(firstPass(row, col) - secondPass(row, col)));
+      }
+    }
+
+    const double relDiff = (maxElement > 0)?maxDiff / maxElement:maxDiff;
+    std::cout << "Unfolding covariance for " << h_folded->GetName() << " differs from the second pass by at most " << relDiff << " of its largest element.\n";
+    if(relDiff > maxCovDiff)
+    {
+      std::cerr << "Unfolding covariance for " << h_folded->GetName() << " disagrees with the second pass.  Using the second pass.\n";
+      return secondPass;
+    }
+    return firstPass;
+  }
+
+  //The covariance matrix from unfolding the CV is the statistical uncertainty from
+  //unfolding.  Its diagonal is already in the CV's errors, so only keep the correlations.
+  void PushStatUnfoldingCov(PlotUtils::MnvH1D* h_unfolded, TMatrixD unfoldingCovMatrix)
+  {
+    const int correctNbins = h_unfolded->fN,
+              matrixRows = unfoldingCovMatrix.GetNrows();
+    if(correctNbins!=matrixRows){
+      std::cout << "****************************************************************************" << std::endl;
+      std::cout << "*  Fixing unfolding matrix size because of RooUnfold bug. From " << matrixRows << " to " << correctNbins << std::endl;
+      std::cout << "****************************************************************************" << std::endl;
+      // It looks like this, since the extra last two bins don't have any content
+      unfoldingCovMatrix.ResizeTo(correctNbins, correctNbins);
+    }
+
+    for(int i=0; i<unfoldingCovMatrix.GetNrows(); ++i) unfoldingCovMatrix(i,i)=0;
+    h_unfolded->PushCovMatrix("unfoldingCov",unfoldingCovMatrix);
+  }
+
+  //One TH1D to unfold and where to put it when it's done
+  struct UnfoldJob
+  {
+    TH1D* folded;
+    std::unique_ptr<TH1D> unfolded;
+    TMatrixD covMatrix;
+  };
+
+  void CopyContents(const TH1& from, TH1& to)
+  {
+    for(int whichBin = 0; whichBin < from.GetNcells(); ++whichBin)
+    {
+      to.SetBinContent(whichBin, from.GetBinContent(whichBin));
+      to.SetBinError(whichBin, from.GetBinError(whichBin));
+    }
+  }
+
+  //Unfolded universes of one error band go back in the same order they were queued
+  template <class BAND>
+  void FillUnfoldedBand(BAND* band, const std::vector<UnfoldJob>& jobs, size_t& nextJob)
+  {
+    for(unsigned int whichUniv = 0; whichUniv < band->GetNHists(); ++whichUniv, ++nextJob)
+    {
+      CopyContents(*jobs[nextJob].unfolded, *band->GetHist(whichUniv));
+    }
+  }
+}
+
+namespace util
+{
+  //Unfolding function from Aaron Bercelle
+  //TODO: Trim it down a little?
+  //Each call gets its own MnvUnfold so that prefixes can be unfolded on different threads.
+  //MnvUnfold unfolds the CV with the CV of h_migration and its projections, so the
+  //covariance it hands back is already the statistical covariance from unfolding.
+  PlotUtils::MnvH1D* UnfoldHist( PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter )
+  {
+    MinervaUnfold::MnvUnfold unfold;
+    PlotUtils::MnvH1D* h_unfolded = nullptr;
+
+    TMatrixD unfoldingCovMatrix;
+    if(!unfold.UnfoldHisto( h_unfolded, unfoldingCovMatrix, h_migration, h_folded, RooUnfold::kBayes, num_iter, true, false ))
+      return nullptr;
+
+    if(getenv("MNV101_CHECK_UNFOLDING_COV")) unfoldingCovMatrix = CheckUnfoldingCov(unfoldingCovMatrix, h_unfolded, h_folded, h_migration, num_iter);
+    PushStatUnfoldingCov(h_unfolded, unfoldingCovMatrix);
+    return h_unfolded;
+  }
+
+  PlotUtils::MnvH1D* UnfoldHistParallel(PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter, const int nThreads)
+  {
+    //Every universe is unfolded with the CV response just like UnfoldHist() does.
+    //Set it up once and share it between threads.  Nobody writes to it.
+    TH2D migration = h_migration->GetCVHistoWithStatError();
+    TH1D reco = h_migration->ProjectionX()->GetCVHistoWithStatError(),
+         truth = h_migration->ProjectionY()->GetCVHistoWithStatError(),
+         cv = h_folded->GetCVHistoWithStatError();
+
+    //The CV comes first, then vertical bands' universes, then lateral bands' universes
+    std::vector<UnfoldJob> jobs;
+    jobs.push_back(UnfoldJob{&cv, nullptr, TMatrixD()});
+
+    const auto vertNames = h_folded->GetVertErrorBandNames(), latNames = h_folded->GetLatErrorBandNames();
+    for(const auto& name: vertNames)
+    {
+      auto band = h_folded->GetVertErrorBand(name);
+      for(unsigned int whichUniv = 0; whichUniv < band->GetNHists(); ++whichUniv) jobs.push_back(UnfoldJob{band->GetHist(whichUniv), nullptr, TMatrixD()});
+    }
+    for(const auto& name: latNames)
+    {
+      auto band = h_folded->GetLatErrorBand(name);
+      for(unsigned int whichUniv = 0; whichUniv < band->GetNHists(); ++whichUniv) jobs.push_back(UnfoldJob{band->GetHist(whichUniv), nullptr, TMatrixD()});
+    }
+
+    //Each thread has its own MnvUnfold and takes the next job nobody has started yet
+    std::atomic<size_t> nextJob(0);
+    std::atomic<bool> failed(false);
+    const auto work = [&]()
+                      {
+                        MinervaUnfold::MnvUnfold unfold;
+                        for(size_t whichJob = nextJob++; whichJob < jobs.size() && !failed; whichJob = nextJob++)
+                        {
+                          TH1D* original = new TH1D(*jobs[whichJob].folded);
+                          TH1D* unfolded = original;
+                          if(!unfold.UnfoldHisto(unfolded, jobs[whichJob].covMatrix, &migration, &reco, &truth, jobs[whichJob].folded, RooUnfold::kBayes, num_iter)) failed = true;
+                          if(unfolded != original) delete original;
+                          jobs[whichJob].unfolded.reset(unfolded);
+                        }
+                      };
+
+    std::vector<std::thread> workers;
+    for(int whichThread = 1; whichThread < nThreads; ++whichThread) workers.emplace_back(work);
+    work();
+    for(auto& worker: workers) worker.join();
+
+    if(failed) return nullptr;
+
+    //Put the unfolded MnvH1D back together.  New error bands copy the CV, so fill it first.
+    auto h_unfolded = new PlotUtils::MnvH1D(*jobs.front().unfolded);
+    h_unfolded->SetName((std::string(h_folded->GetName()) + "_unfolded").c_str());
+
+    size_t nextResult = 1;
+    for(const auto& name: vertNames)
+    {
+      const auto foldedBand = h_folded->GetVertErrorBand(name);
+      h_unfolded->AddVertErrorBand(name, foldedBand->GetNHists());
+      auto band = h_unfolded->GetVertErrorBand(name);
+      band->SetUseSpreadError(foldedBand->GetUseSpreadError());
+      FillUnfoldedBand(band, jobs, nextResult);
+    }
+    for(const auto& name: latNames)
+    {
+      const auto foldedBand = h_folded->GetLatErrorBand(name);
+      h_unfolded->AddLatErrorBand(name, foldedBand->GetNHists());
+      auto band = h_unfolded->GetLatErrorBand(name);
+      band->SetUseSpreadError(foldedBand->GetUseSpreadError());
+      FillUnfoldedBand(band, jobs, nextResult);
+    }
+
+    if(getenv("MNV101_CHECK_UNFOLDING_COV")) jobs.front().covMatrix = CheckUnfoldingCov(jobs.front().covMatrix, h_unfolded, h_folded, h_migration, num_iter);
+    PushStatUnfoldingCov(h_unfolded, jobs.front().covMatrix);
+    return h_unfolded;
+  }
+
+  BayesUnfolder::BayesUnfolder(const TH2D& migration, const TH1D& truth): fNReco(migration.GetNbinsX() + 2), fNTruth(migration.GetNbinsY() + 2),
+                                                                          fResponse(fNReco * fNTruth, 0), fEfficiency(fNTruth, 0), fPrior(fNTruth, 0)
+  {
+    if(truth.GetNcells() != fNTruth) throw std::runtime_error(std::string("Truth histogram ") + truth.GetName() + " doesn't have the same binning as the truth axis of " + migration.GetName());
+
+    //Underflow and overflow bins keep a response, efficiency, and prior of 0
+    for(int whichTruth = 1; whichTruth < fNTruth - 1; ++whichTruth)
+    {
+      const double nTrue = truth.GetBinContent(whichTruth);
+      if(nTrue <= 0) continue;
+
+      for(int whichReco = 1; whichReco < fNReco - 1; ++whichReco)
+      {
+        const double prob = migration.GetBinContent(whichReco, whichTruth) / nTrue;
+        fResponse[whichTruth * fNReco + whichReco] = prob;
+        fEfficiency[whichTruth] += prob;
+      }
+      fPrior[whichTruth] = nTrue;
+    }
+
+    const double sumPrior = std::accumulate(fPrior.begin(), fPrior.end(), 0.);
+    if(sumPrior <= 0) throw std::runtime_error(std::string("Truth histogram ") + truth.GetName() + " is empty, so there's no prior to unfold with.");
+    for(auto& prior: fPrior) prior /= sumPrior;
+  }
+
+  std::vector<std::vector<double>> BayesUnfolder::Scan(const std::vector<double>& data, const std::vector<int>& iterations) const
+  {
+    if(static_cast<int>(data.size()) != fNReco) throw std::runtime_error("Data to unfold doesn't have the same number of bins as the reco axis of the migration matrix.");
+    if(!std::is_sorted(iterations.begin(), iterations.end()) || (!iterations.empty() && iterations.front() < 1)) throw std::runtime_error("Iterations to scan must be positive and in increasing order.");
+
+    std::vector<std::vector<double>> snapshots;
+    snapshots.reserve(iterations.size());
+
+    std::vector<double> prior = fPrior, folded(fNReco), unfolded(fNTruth);
+    auto nextSnapshot = iterations.begin();
+
+    for(int iteration = 1; nextSnapshot != iterations.end(); ++iteration)
+    {
+      //Fold the prior to get the expected reco distribution
+      std::fill(folded.begin(), folded.end(), 0.);
+      for(int whichTruth = 0; whichTruth < fNTruth; ++whichTruth)
+      {
+        const double* response = fResponse.data() + whichTruth * fNReco;
+        for(int whichReco = 0; whichReco < fNReco; ++whichReco) folded[whichReco] += response[whichReco] * prior[whichTruth];
+      }
+
+      //Bayes' theorem assigns each reco bin's data back to truth bins in proportion to prior * P(reco | truth)
+      for(int whichReco = 0; whichReco < fNReco; ++whichReco) folded[whichReco] = (folded[whichReco] > 0)?data[whichReco] / folded[whichReco]:0;
+
+      double sumUnfolded = 0;
+      for(int whichTruth = 0; whichTruth < fNTruth; ++whichTruth)
+      {
+        unfolded[whichTruth] = 0;
+        if(fEfficiency[whichTruth] <= 0) continue;
+
+        const double* response = fResponse.data() + whichTruth * fNReco;
+        double sum = 0;
+        for(int whichReco = 0; whichReco < fNReco; ++whichReco) sum += response[whichReco] * folded[whichReco];
+        unfolded[whichTruth] = sum * prior[whichTruth] / fEfficiency[whichTruth];
+        sumUnfolded += unfolded[whichTruth];
+      }
+
+      for(; nextSnapshot != iterations.end() && *nextSnapshot == iteration; ++nextSnapshot) snapshots.push_back(unfolded);
+
+      //This iteration's result is the next iteration's prior
+      if(sumUnfolded <= 0) break;
+      for(int whichTruth = 0; whichTruth < fNTruth; ++whichTruth) prior[whichTruth] = unfolded[whichTruth] / sumUnfolded;
+    }
+
+    //If the data were empty, every later iteration is the same as the last one
+    for(; nextSnapshot != iterations.end(); ++nextSnapshot) snapshots.push_back(unfolded);
+
+    return snapshots;
+  }
+
+  double CompareToMnvUnfold(const TH2D& migration, const TH1D& truth, const TH1D& data, const std::vector<int>& iterations)
+  {
+    std::vector<double> contents(data.GetNcells());
+    for(int whichBin = 0; whichBin < data.GetNcells(); ++whichBin) contents[whichBin] = data.GetBinContent(whichBin);
+    const auto scanned = BayesUnfolder(migration, truth).Scan(contents, iterations);
+
+    //Same response UnfoldHistParallel() gives MnvUnfold
+    std::unique_ptr<TH1D> reco(migration.ProjectionX("CompareToMnvUnfold_reco", 0, -1));
+    MinervaUnfold::MnvUnfold unfold;
+
+    double maxDiff = 0;
+    for(size_t whichIter = 0; whichIter < iterations.size(); ++whichIter)
+    {
+      TH1D* original = new TH1D(data);
+      TH1D* unfolded = original;
+      TMatrixD covMatrix;
+      const bool succeeded = unfold.UnfoldHisto(unfolded, covMatrix, &migration, reco.get(), &truth, &data, RooUnfold::kBayes, iterations[whichIter]);
+      if(unfolded != original) delete original;
+      std::unique_ptr<TH1D> result(unfolded);
+      if(!succeeded) throw std::runtime_error("MnvUnfold failed to unfold " + std::string(data.GetName()) + " with " + std::to_string(iterations[whichIter]) + " iterations.");
+
+      double maxContent = 0, maxIterDiff = 0;
+      for(int whichBin = 1; whichBin <= result->GetNbinsX(); ++whichBin)
+      {
+        maxContent = std::max(maxContent, std::fabs(result->GetBinContent(whichBin)));
+        maxIterDiff = std::max(maxIterDiff, std::fabs(result->GetBinContent(whichBin) - scanned[whichIter][whichBin]));
+      }
+      if(maxContent > 0) maxDiff = std::max(maxDiff, maxIterDiff / maxContent);
+    }
+
+    return maxDiff;
+  }
+}
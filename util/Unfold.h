@@ -0,0 +1,72 @@
+//File: Unfold.h
+//Brief: d'Agostini unfolding for cross section extraction.  UnfoldHist() hands
+//       the whole MnvH1D to MnvUnfold.  UnfoldHistParallel() unfolds each
+//       universe of each error band as its own TH1D on a pool of threads and
+//       puts the results back together into an MnvH1D.  Both push the
+//       statistical covariance from unfolding the CV as "unfoldingCov".
+//       BayesUnfolder does the same iterations without RooUnfold so that
+//       every iteration count of a warping study comes out of one pass.
+
+#ifndef UTIL_UNFOLD_H
+#define UTIL_UNFOLD_H
+
+//c++ includes
+#include <vector>
+
+class TH1D;
+class TH2D;
+
+namespace PlotUtils
+{
+  class MnvH1D;
+  class MnvH2D;
+}
+
+namespace util
+{
+  //Unfold h_folded and each of its universes using the CV of h_migration.
+  //Returns nullptr if unfolding failed.
+  PlotUtils::MnvH1D* UnfoldHist(PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter);
+
+  //Same result as UnfoldHist(), but the CV and every universe are unfolded concurrently
+  //on nThreads threads that each have their own MnvUnfold.  Call ROOT::EnableThreadSafety()
+  //before using more than 1 thread.
+  PlotUtils::MnvH1D* UnfoldHistParallel(PlotUtils::MnvH1D* h_folded, PlotUtils::MnvH2D* h_migration, const int num_iter, const int nThreads);
+
+  //d'Agostini's iterative Bayesian unfolding like RooUnfold::kBayes without fakes.
+  //The response is set up once and shared by every call to Scan().  Iteration k
+  //starts from iteration k-1, so Scan() keeps a snapshot of every iteration count
+  //it's asked for instead of starting over for each one.
+  //Bin numbers are global bin numbers including underflow and overflow, but
+  //underflow and overflow are left out of unfolding like RooUnfold's default.
+  //They always unfold to 0.
+  class BayesUnfolder
+  {
+    public:
+      //migration has reco on the x axis and truth on the y axis.  truth is the
+      //efficiency denominator and the first prior.
+      BayesUnfolder(const TH2D& migration, const TH1D& truth);
+
+      //Unfolded contents of data after each of iterations, in the same order.
+      //iterations must be positive and in increasing order.
+      std::vector<std::vector<double>> Scan(const std::vector<double>& data, const std::vector<int>& iterations) const;
+
+      int GetNRecoBins() const { return fNReco; }
+      int GetNTruthBins() const { return fNTruth; }
+
+    private:
+      int fNReco;
+      int fNTruth;
+
+      std::vector<double> fResponse; //P(reco | truth) stored as [truth * fNReco + reco]
+      std::vector<double> fEfficiency; //Sum of fResponse over reco for each truth bin
+      std::vector<double> fPrior; //Normalized truth distribution
+  };
+
+  //Largest difference between BayesUnfolder and MnvUnfold's kBayes unfolding data after
+  //each of iterations relative to the largest bin MnvUnfold unfolded.  Only compares
+  //bins inside the histograms' range.  Throws std::runtime_error if MnvUnfold fails.
+  double CompareToMnvUnfold(const TH2D& migration, const TH1D& truth, const TH1D& data, const std::vector<int>& iterations);
+}
+
+#endif //UTIL_UNFOLD_H
@@ -0,0 +1,121 @@
+//File: UniverseMatrix.cpp
+//Brief: The CV and every universe of every error band of an MnvH1D as one
+//       contiguous (universe x bin) matrix.  Row 0 is the CV.  Each error band's
+//       universes are consecutive rows after it.  Cross section extraction steps
+//       that act the same way on every universe can run over these rows in a
+//       single tight loop instead of one MnvH1D operation per band.
+//       Bins are global bin numbers including underflow and overflow.
+
+//Includes from this package
+#include "util/UniverseMatrix.h"
+
+//PlotUtils includes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverloaded-virtual"
+#include "PlotUtils/MnvH1D.h"
+#pragma GCC diagnostic pop
+
+//c++ includes
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+  void CopyRow(const TH1& hist, double* content, double* err2)
+  {
+    for(int whichBin = 0; whichBin < hist.GetNcells(); ++whichBin)
+    {
+      content[whichBin] = hist.GetBinContent(whichBin);
+      err2[whichBin] = hist.GetBinError(whichBin) * hist.GetBinError(whichBin);
+    }
+  }
+
+  void PasteRow(const double* content, const double* err2, TH1& hist)
+  {
+    for(int whichBin = 0; whichBin < hist.GetNcells(); ++whichBin)
+    {
+      hist.SetBinContent(whichBin, content[whichBin]);
+      hist.SetBinError(whichBin, std::sqrt(err2[whichBin]));
+    }
+  }
+}
+
+namespace util
+{
+  UniverseMatrix::UniverseMatrix(const PlotUtils::MnvH1D& hist): fNRows(1), fNBins(hist.GetNcells())
+  {
+    for(const auto& name: hist.GetVertErrorBandNames())
+    {
+      const auto band = hist.GetVertErrorBand(name);
+      fBands.push_back(Band{name, false, band->GetUseSpreadError(), fNRows, static_cast<int>(band->GetNHists())});
+      fNRows += band->GetNHists();
+    }
+
+    for(const auto& name: hist.GetLatErrorBandNames())
+    {
+      const auto band = hist.GetLatErrorBand(name);
+      fBands.push_back(Band{name, true, band->GetUseSpreadError(), fNRows, static_cast<int>(band->GetNHists())});
+      fNRows += band->GetNHists();
+    }
+
+    Fill(hist);
+  }
+
+  UniverseMatrix::UniverseMatrix(const PlotUtils::MnvH1D& hist, const UniverseMatrix& layout): fNRows(layout.fNRows), fNBins(layout.fNBins), fBands(layout.fBands)
+  {
+    if(hist.GetNcells() != fNBins) throw std::runtime_error(std::string(hist.GetName()) + " has a different number of bins from the other histograms in this extraction.");
+
+    Fill(hist);
+  }
+
+  void UniverseMatrix::Fill(const PlotUtils::MnvH1D& hist)
+  {
+    fContent.resize(fNRows * fNBins);
+    fErr2.resize(fNRows * fNBins);
+
+    CopyRow(hist, Content(0), Err2(0));
+    for(const auto& band: fBands)
+    {
+      const bool hasBand = band.isLateral?hist.HasLatErrorBand(band.name):hist.HasVertErrorBand(band.name);
+      const unsigned int nHists = hasBand?(band.isLateral?hist.GetLatErrorBand(band.name)->GetNHists():hist.GetVertErrorBand(band.name)->GetNHists()):band.nUniverses;
+      if(static_cast<int>(nHists) != band.nUniverses) throw std::runtime_error(std::string(hist.GetName()) + " has a different number of universes in error band " + band.name + " from the other histograms in this extraction.");
+
+      for(int whichUniv = 0; whichUniv < band.nUniverses; ++whichUniv)
+      {
+        const int row = band.firstRow + whichUniv;
+        if(!hasBand) CopyRow(hist, Content(row), Err2(row));
+        else if(band.isLateral) CopyRow(*hist.GetLatErrorBand(band.name)->GetHist(whichUniv), Content(row), Err2(row));
+        else CopyRow(*hist.GetVertErrorBand(band.name)->GetHist(whichUniv), Content(row), Err2(row));
+      }
+    }
+  }
+
+  PlotUtils::MnvH1D* UniverseMatrix::ToMnvH1D(const PlotUtils::MnvH1D& binningTemplate, const std::string& name) const
+  {
+    //New error bands copy the CV, so fill it first
+    TH1D cv(binningTemplate.GetCVHistoWithStatError());
+    cv.SetName(name.c_str());
+    PasteRow(Content(0), Err2(0), cv);
+    auto result = new PlotUtils::MnvH1D(cv);
+
+    for(const auto& band: fBands)
+    {
+      if(band.isLateral)
+      {
+        result->AddLatErrorBand(band.name, band.nUniverses);
+        auto errBand = result->GetLatErrorBand(band.name);
+        errBand->SetUseSpreadError(band.useSpreadError);
+        for(int whichUniv = 0; whichUniv < band.nUniverses; ++whichUniv) PasteRow(Content(band.firstRow + whichUniv), Err2(band.firstRow + whichUniv), *errBand->GetHist(whichUniv));
+      }
+      else
+      {
+        result->AddVertErrorBand(band.name, band.nUniverses);
+        auto errBand = result->GetVertErrorBand(band.name);
+        errBand->SetUseSpreadError(band.useSpreadError);
+        for(int whichUniv = 0; whichUniv < band.nUniverses; ++whichUniv) PasteRow(Content(band.firstRow + whichUniv), Err2(band.firstRow + whichUniv), *errBand->GetHist(whichUniv));
+      }
+    }
+
+    return result;
+  }
+}
@@ -0,0 +1,73 @@
+//File: UniverseMatrix.h
+//Brief: The CV and every universe of every error band of an MnvH1D as one
+//       contiguous (universe x bin) matrix.  Row 0 is the CV.  Each error band's
+//       universes are consecutive rows after it.  Cross section extraction steps
+//       that act the same way on every universe can run over these rows in a
+//       single tight loop instead of one MnvH1D operation per band.
+//       Bins are global bin numbers including underflow and overflow.
+
+#ifndef UTIL_UNIVERSEMATRIX_H
+#define UTIL_UNIVERSEMATRIX_H
+
+//c++ includes
+#include <string>
+#include <vector>
+
+namespace PlotUtils
+{
+  class MnvH1D;
+}
+
+namespace util
+{
+  class UniverseMatrix
+  {
+    public:
+      //Where an error band's universes are
+      struct Band
+      {
+        std::string name;
+        bool isLateral;
+        bool useSpreadError;
+        int firstRow;
+        int nUniverses;
+      };
+
+      //Copy hist and all of its error bands
+      explicit UniverseMatrix(const PlotUtils::MnvH1D& hist);
+
+      //Copy hist with the same rows as layout.  Error bands that hist doesn't have
+      //are filled with hist's CV just like MnvH1D::AddMissingErrorBandsAndFillWithCV().
+      //Throws std::runtime_error if a band has a different number of universes or
+      //hist has a different number of bins.
+      UniverseMatrix(const PlotUtils::MnvH1D& hist, const UniverseMatrix& layout);
+
+      //A new MnvH1D with the same binning as binningTemplate with these contents
+      //and the same error bands as this matrix.  Doesn't copy binningTemplate's
+      //error bands or covariance matrices.
+      PlotUtils::MnvH1D* ToMnvH1D(const PlotUtils::MnvH1D& binningTemplate, const std::string& name) const;
+
+      int GetNRows() const { return fNRows; }
+      int GetNBins() const { return fNBins; }
+      const std::vector<Band>& GetBands() const { return fBands; }
+
+      //Bin contents and squared bin errors of one universe
+      double* Content(const int row) { return fContent.data() + row * fNBins; }
+      const double* Content(const int row) const { return fContent.data() + row * fNBins; }
+      double* Err2(const int row) { return fErr2.data() + row * fNBins; }
+      const double* Err2(const int row) const { return fErr2.data() + row * fNBins; }
+
+    private:
+      int fNRows;
+      int fNBins;
+      std::vector<Band> fBands;
+
+      std::vector<double> fContent; //[row * fNBins + bin]
+      std::vector<double> fErr2; //Same layout as fContent
+
+      //Allocate storage for fBands' rows and copy hist into it
+      void Fill(const PlotUtils::MnvH1D& hist);
+  };
+}
+
+#endif //UTIL_UNIVERSEMATRIX_H
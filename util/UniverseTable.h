@@ -0,0 +1,59 @@
+//File: UniverseTable.h
+//Brief: Every universe in a map of error bands in one flat array.  The event
+//       loops walk it without copying each band's vector of universes, and
+//       anything they need per band is looked up once here instead of once
+//       per entry.
+
+#ifndef UTIL_UNIVERSETABLE_H
+#define UTIL_UNIVERSETABLE_H
+
+//Includes from this package
+#include "util/PerfCounters.h"
+#include "studies/Study.h"
+
+//c++ includes
+#include <string>
+#include <vector>
+#include <map>
+
+class CVUniverse;
+
+struct UniverseTable
+{
+  struct Band
+  {
+    std::string name;
+    std::vector<const std::vector<Study*>*> studies; //Which Studies need this band for each AnalysisConfig
+    util::PerfCounters::Row* perf; //nullptr unless counting
+  };
+
+  struct Slot
+  {
+    CVUniverse* universe;
+    const Band* band;
+  };
+
+  std::vector<Band> bands;
+  std::vector<Slot> universes; //In the same order as looping over the map
+
+  //studiesByBand comes from StudiesByBand() for each AnalysisConfig.  perf may be nullptr.
+  UniverseTable(const std::map<std::string, std::vector<CVUniverse*>>& errorBands,
+                const std::vector<std::map<std::string, std::vector<Study*>>>& studiesByBand, util::PerfCounters* perf)
+  {
+    bands.reserve(errorBands.size()); //Slots point into bands
+    for(const auto& band: errorBands)
+    {
+      Band info;
+      info.name = band.first;
+      for(const auto& configStudies: studiesByBand) info.studies.push_back(&configStudies.at(band.first));
+      info.perf = perf?&perf->GetRow(band.first):nullptr;
+      bands.push_back(info);
+
+      for(const auto universe: band.second) universes.push_back(Slot{universe, &bands.back()});
+    }
+  }
+
+  UniverseTable(const UniverseTable&) = delete; //Slots would still point into the original
+};
+
+#endif //UTIL_UNIVERSETABLE_H
@@ -5,6 +5,8 @@
 #include "event/CVUniverse.h"
 #include "util/SafeROOTName.h"
 #include "util/Categorized.h"
+#include "util/CompactHist.h"
+#include "util/Manifest.h"
 
 //PlotUtils includes
 #include "PlotUtils/VariableBase.h"
@@ -34,6 +36,18 @@ class Variable: public PlotUtils::VariableBase<CVUniverse>
 							   GetName().c_str(), BKGLabels,
 							   GetBinVec(), mc_error_bands);
 
+      //Only the CV is broken down by GENIE interaction type.  It's for stacked
+      //background plots, not for the cross section, so it doesn't need systematics.
+      //Not named <variable>_background_* so that Manifest::FromKeys() doesn't
+      //mistake it for a background to subtract.
+      std::map<int, std::string> GENIELabels = {{1, "QE"},
+                                                {8, "2p2h"},
+                                                {2, "RES"},
+                                                {3, "DIS"}};
+      std::map<std::string, std::vector<CVUniverse*>> cvBand = {{"cv", mc_error_bands.at("cv")}};
+      m_backgroundsByGENIELabel = new util::CategorizedGrid<Hist>(GetName() + "_by_BKG_and_GENIE_Label", GetName(),
+                                                                  BKGLabels, GENIELabels, GetBinVec(), cvBand);
+
       efficiencyNumerator = new Hist((GetName() + "_efficiency_numerator").c_str(), GetName().c_str(), GetBinVec(), mc_error_bands);
       efficiencyDenominator = new Hist((GetName() + "_efficiency_denominator").c_str(), GetName().c_str(), GetBinVec(), truth_error_bands);
       selectedSignalReco = new Hist((GetName() + "_selected_signal_reco").c_str(), GetName().c_str(), GetBinVec(), mc_error_bands);
@@ -43,6 +57,7 @@ class Variable: public PlotUtils::VariableBase<CVUniverse>
 
     //Histograms to be filled
     util::Categorized<Hist, int>* m_backgroundHists;
+    util::CategorizedGrid<Hist>* m_backgroundsByGENIELabel; //Background type by GENIE interaction type.  CV only.
     Hist* dataHist;
     Hist* efficiencyNumerator;
     Hist* efficiencyDenominator;
@@ -56,64 +71,166 @@ class Variable: public PlotUtils::VariableBase<CVUniverse>
       dataHist = new Hist((GetName() + "_data").c_str(), GetName().c_str(), GetBinVec(), data_error_bands);
     }
 
-    void WriteData(TFile& file)
+    //Reco distributions in a sideband.  Named just like the signal region's
+    //histograms so that each sideband's directory gets its own Manifest.
+    struct SidebandHists
+    {
+      util::Categorized<Hist, int>* backgrounds;
+      Hist* selectedSignalReco;
+      Hist* data;
+    };
+    std::vector<SidebandHists> m_sidebands;
+
+    void InitializeSidebandHists(const size_t nSidebands, std::map<std::string, std::vector<CVUniverse*>>& mc_error_bands,
+                                 std::vector<CVUniverse*>& data_error_bands)
+    {
+      std::map<int, std::string> BKGLabels = {{0, "NC"},
+                                               {1, "Wrong_Sign"}};
+
+      for(size_t whichSideband = 0; whichSideband < nSidebands; ++whichSideband)
+      {
+        SidebandHists sideband;
+        sideband.backgrounds = new util::Categorized<Hist, int>((GetName() + "_background").c_str(), GetName().c_str(), BKGLabels, GetBinVec(), mc_error_bands);
+        sideband.selectedSignalReco = new Hist((GetName() + "_selected_signal_reco").c_str(), GetName().c_str(), GetBinVec(), mc_error_bands);
+        sideband.data = new Hist((GetName() + "_data").c_str(), GetName().c_str(), GetBinVec(), data_error_bands);
+        m_sidebands.push_back(sideband);
+      }
+    }
+
+    void WriteSidebandMC(TDirectory& file, const size_t whichSideband)
+    {
+      auto& sideband = m_sidebands[whichSideband];
+      sideband.backgrounds->visit([&file](Hist& categ)
+                                  {
+                                    categ.SyncCVHistos();
+                                    util::WriteHist(*categ.hist, file, categ.hist->GetName());
+                                  });
+      sideband.selectedSignalReco->SyncCVHistos();
+      util::WriteHist(*sideband.selectedSignalReco->hist, file, sideband.selectedSignalReco->hist->GetName());
+    }
+
+    void WriteSidebandData(TDirectory& file, const size_t whichSideband)
+    {
+      auto& data = *m_sidebands[whichSideband].data;
+      data.SyncCVHistos();
+      util::WriteHist(*data.hist, file, data.hist->GetName());
+    }
+
+    //Names of the ingredients WriteSidebandMC() and WriteSidebandData() write
+    util::Manifest::Entry GetSidebandMCManifestEntry(const size_t whichSideband)
+    {
+      util::Manifest::Entry entry;
+      entry.variable = GetName();
+      entry.data = GetName() + "_data";
+      entry.selectedSignalReco = m_sidebands[whichSideband].selectedSignalReco->hist->GetName();
+      m_sidebands[whichSideband].backgrounds->visit([&entry](Hist& categ) { entry.backgrounds.push_back(categ.hist->GetName()); });
+
+      return entry;
+    }
+
+    util::Manifest::Entry GetSidebandDataManifestEntry(const size_t whichSideband)
+    {
+      util::Manifest::Entry entry;
+      entry.variable = GetName();
+      entry.data = m_sidebands[whichSideband].data->hist->GetName();
+
+      return entry;
+    }
+
+    //WriteData() and WriteMC() touch different histograms, so they can run
+    //while the other kind of event loop is still filling.
+    void WriteData(TDirectory& file)
     {
+      dataHist->SyncCVHistos();
       if (dataHist->hist) {
-                dataHist->hist->SetDirectory(&file);
-                dataHist->hist->Write();
+        util::WriteHist(*dataHist->hist, file, dataHist->hist->GetName());
       }
     }
 
-    void WriteMC(TFile& file)
+    void WriteMC(TDirectory& file)
     {
-      SyncCVHistos();
+      SyncMCHistos();
       file.cd();
 
       m_backgroundHists->visit([&file](Hist& categ)
                                     {
-                                      categ.hist->SetDirectory(&file);
-                                      categ.hist->Write(); //TODO: Or let the TFile destructor do this the "normal" way?                                                                                           
+                                      util::WriteHist(*categ.hist, file, categ.hist->GetName());
                                     });
 
+      m_backgroundsByGENIELabel->visit([&file](Hist& categ)
+                                       {
+                                         util::WriteHist(*categ.hist, file, categ.hist->GetName());
+                                       });
+
       if(efficiencyNumerator)
       {
-        efficiencyNumerator->hist->SetDirectory(&file); //TODO: Can I get around having to call SetDirectory() this many times somehow?
-        efficiencyNumerator->hist->Write();
+        util::WriteHist(*efficiencyNumerator->hist, file, efficiencyNumerator->hist->GetName());
       }
 
       if(efficiencyDenominator)
       {
-        efficiencyDenominator->hist->SetDirectory(&file);
-        efficiencyDenominator->hist->Write();
+        util::WriteHist(*efficiencyDenominator->hist, file, efficiencyDenominator->hist->GetName());
       }
 
       if(migration)
       {
-        migration->hist->SetDirectory(&file); 
-        migration->hist->Write();
+        util::WriteHist(*migration->hist, file, migration->hist->GetName());
       }
 
       if(selectedSignalReco)
       {
-        selectedSignalReco->hist->SetDirectory(&file);
-        selectedSignalReco->hist->Write();
+        util::WriteHist(*selectedSignalReco->hist, file, selectedSignalReco->hist->GetName());
       }
 
       if(selectedMCReco)
       {
-        selectedMCReco->hist->SetDirectory(&file);
-        selectedMCReco->hist->Write((GetName() + "_data").c_str()); //Make this histogram look just like the data for closure tests
+        util::WriteHist(*selectedMCReco->hist, file, GetName() + "_data"); //Make this histogram look just like the data for closure tests
       }
     }
 
+    //Names of the ingredients WriteMC() writes plus what runEventLoop writes
+    //for this Variable's flux and number of nucleons
+    util::Manifest::Entry GetMCManifestEntry()
+    {
+      util::Manifest::Entry entry;
+      entry.variable = GetName();
+      entry.data = GetName() + "_data";
+      entry.efficiencyNumerator = efficiencyNumerator->hist->GetName();
+      entry.efficiencyDenominator = efficiencyDenominator->hist->GetName();
+      entry.migration = migration->hist->GetName();
+      entry.selectedSignalReco = selectedSignalReco->hist->GetName();
+      entry.flux = GetName() + "_reweightedflux_integrated";
+      entry.fiducialNucleons = GetName() + "_fiducial_nucleons";
+      m_backgroundHists->visit([&entry](Hist& categ) { entry.backgrounds.push_back(categ.hist->GetName()); });
+
+      return entry;
+    }
+
+    //Names of the ingredients WriteData() writes
+    util::Manifest::Entry GetDataManifestEntry()
+    {
+      util::Manifest::Entry entry;
+      entry.variable = GetName();
+      entry.data = dataHist->hist->GetName();
+
+      return entry;
+    }
+
     //Only call this manually if you Draw(), Add(), or Divide() plots in this
     //program.
     //Makes sure that all error bands know about the CV.  In the Old Systematics
     //Framework, this was implicitly done by the event loop.
     void SyncCVHistos()
     {
-      m_backgroundHists->visit([](Hist& categ) { categ.SyncCVHistos(); });
       if(dataHist) dataHist->SyncCVHistos();
+      SyncMCHistos();
+    }
+
+    //Everything but dataHist
+    void SyncMCHistos()
+    {
+      m_backgroundHists->visit([](Hist& categ) { categ.SyncCVHistos(); });
+      m_backgroundsByGENIELabel->visit([](Hist& categ) { categ.SyncCVHistos(); });
       if(efficiencyNumerator) efficiencyNumerator->SyncCVHistos();
       if(efficiencyDenominator) efficiencyDenominator->SyncCVHistos();
       if(selectedSignalReco) selectedSignalReco->SyncCVHistos();
@@ -4,6 +4,7 @@
 #include "util/SafeROOTName.h"
 #include "PlotUtils/Variable2DBase.h"
 #include "util/Categorized.h"
+#include "util/CompactHist.h"
 
 class Variable2D: public PlotUtils::Variable2DBase<CVUniverse>
 {
@@ -45,32 +46,38 @@ class Variable2D: public PlotUtils::Variable2DBase<CVUniverse>
  
     }
 
-    void Write(TFile& file)
+    //Both go in the MC file.  WriteData() only touches dataHist, so WriteMC()
+    //can run while the data loop is still filling.
+    void WriteData(TFile& file)
     {
-      SyncCVHistos();
+      dataHist->SyncCVHistos();
+      file.cd();
+
+      if (dataHist->hist) {
+        util::WriteHist(*dataHist->hist, file, dataHist->hist->GetName());
+      }
+    }
+
+    void WriteMC(TFile& file)
+    {
+      m_backgroundHists->visit([](Hist& categ) { categ.SyncCVHistos(); });
+      if(efficiencyNumerator) efficiencyNumerator->SyncCVHistos();
+      if(efficiencyDenominator) efficiencyDenominator->SyncCVHistos();
       file.cd();
 
       m_backgroundHists->visit([&file](Hist& categ)
                                     {
-                                      categ.hist->SetDirectory(&file);
-                                      categ.hist->Write(); //TODO: Or let the TFile destructor do this the "normal" way?                                                                                           
+                                      util::WriteHist(*categ.hist, file, categ.hist->GetName());
                                     });
 
-      if (dataHist->hist) {
-		dataHist->hist->SetDirectory(&file);
-		dataHist->hist->Write();
-      }
-
       if(efficiencyNumerator)
       {
-        efficiencyNumerator->hist->SetDirectory(&file); //TODO: Can I get around having to call SetDirectory() this many times somehow?
-        efficiencyNumerator->hist->Write();
+        util::WriteHist(*efficiencyNumerator->hist, file, efficiencyNumerator->hist->GetName());
       }
 
       if(efficiencyDenominator)
       {
-        efficiencyDenominator->hist->SetDirectory(&file);
-        efficiencyDenominator->hist->Write();
+        util::WriteHist(*efficiencyDenominator->hist, file, efficiencyDenominator->hist->GetName());
       }
     }
 